@@ -0,0 +1,283 @@
+/* fscompress.c - builds the compressed variant of a filesystem image
+ *
+ * Usage: fscompress <filesys_img> <compressed_img>
+ *
+ * The boot block and inodes are copied as they are, with "CFS1" written to
+ * the first reserved bytes of the boot block so fs_init can tell the two
+ * formats apart. The data region becomes num_data_blocks + 1 offsets,
+ * relative to the start of the region, followed by every data block
+ * compressed on its own in the LZ4 block format. A block that does not
+ * shrink is stored as is, exactly BLOCK_SIZE bytes long.
+ *
+ * Every block is inflated again afterwards to check the output, and the
+ * time that takes is printed next to the time to copy the plain blocks.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BLOCK_SIZE 4096
+#define STATS_RESERVED 12 /* offset of the reserved bytes in the boot block */
+#define MIN_MATCH 4
+#define MFLIMIT 12 /* no match may start in the last 12 bytes of a block */
+#define LAST_LITERALS 5 /* and the last 5 bytes are always literals */
+#define HASH_BITS 12
+#define MAX_OFFSET 65535
+#define BENCH_ROUNDS 200
+
+static const uint8_t cfs_magic[4] = {'C', 'F', 'S', '1'};
+
+static uint32_t
+read32 (const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void
+write32 (uint8_t* p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint8_t*
+put_length (uint8_t* op, uint32_t length)
+{
+    while (length >= 255) {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = length;
+    return op;
+}
+
+static uint8_t*
+put_sequence (uint8_t* op, const uint8_t* lit, uint32_t lit_len, uint32_t offset,
+              uint32_t match_len)
+{
+    uint8_t* token = op++;
+
+    *token = (lit_len < 15 ? lit_len : 15) << 4;
+    if (lit_len >= 15)
+        op = put_length (op, lit_len - 15);
+    memcpy (op, lit, lit_len);
+    op += lit_len;
+    if (0 == match_len)
+        return op;
+    *op++ = offset;
+    *op++ = offset >> 8;
+    match_len -= MIN_MATCH;
+    *token |= (match_len < 15 ? match_len : 15);
+    if (match_len >= 15)
+        op = put_length (op, match_len - 15);
+    return op;
+}
+
+/* greedy LZ4 block compressor, dst must hold 2 * len bytes */
+static uint32_t
+lz4_compress (const uint8_t* src, uint32_t len, uint8_t* dst)
+{
+    int32_t table[1 << HASH_BITS];
+    uint32_t ip, anchor, ref, h, match_len;
+    uint8_t* op = dst;
+
+    memset (table, -1, sizeof (table));
+    ip = 0;
+    anchor = 0;
+    while (len >= MFLIMIT && ip + MFLIMIT <= len) {
+        h = (read32 (src + ip) * 2654435761U) >> (32 - HASH_BITS);
+        ref = table[h];
+        table[h] = ip;
+        if ((int32_t)ref < 0 || ip - ref > MAX_OFFSET ||
+            read32 (src + ref) != read32 (src + ip)) {
+            ip++;
+            continue;
+        }
+        match_len = MIN_MATCH;
+        while (ip + match_len < len - LAST_LITERALS &&
+               src[ref + match_len] == src[ip + match_len])
+            match_len++;
+        op = put_sequence (op, src + anchor, ip - anchor, ip - ref, match_len);
+        ip += match_len;
+        anchor = ip;
+    }
+    op = put_sequence (op, src + anchor, len - anchor, 0, 0);
+    return op - dst;
+}
+
+/* same algorithm as lz4_decompress in file_system.c */
+static int32_t
+lz4_decompress (const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len)
+{
+    const uint8_t* ip = src;
+    const uint8_t* ip_end = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* op_end = dst + dst_len;
+    const uint8_t* match;
+    uint32_t token, length, offset, byte;
+
+    while (ip < ip_end) {
+        token = *ip++;
+        length = token >> 4;
+        if (15 == length) {
+            do {
+                if (ip >= ip_end)
+                    return -1;
+                byte = *ip++;
+                length += byte;
+            } while (255 == byte);
+        }
+        if (length > (uint32_t)(ip_end - ip) || length > (uint32_t)(op_end - op))
+            return -1;
+        memcpy (op, ip, length);
+        ip += length;
+        op += length;
+        if (ip == ip_end)
+            break;
+        if (ip_end - ip < 2)
+            return -1;
+        offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (0 == offset || offset > (uint32_t)(op - dst))
+            return -1;
+        length = token & 0x0F;
+        if (15 == length) {
+            do {
+                if (ip >= ip_end)
+                    return -1;
+                byte = *ip++;
+                length += byte;
+            } while (255 == byte);
+        }
+        length += MIN_MATCH;
+        if (length > (uint32_t)(op_end - op))
+            return -1;
+        match = op - offset;
+        while (length-- > 0)
+            *op++ = *match++;
+    }
+    return op - dst;
+}
+
+static double
+seconds (void)
+{
+    struct timespec ts;
+
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int
+main (int argc, char* argv[])
+{
+    FILE* f;
+    long size;
+    uint8_t *img, *out, *block, *check;
+    uint32_t n_inodes, n_blocks, header, table, pos, i, clen, round;
+    volatile uint32_t sink = 0;
+    double t, t_plain, t_lz4;
+
+    if (3 != argc) {
+        fprintf (stderr, "usage: %s <filesys_img> <compressed_img>\n", argv[0]);
+        return 2;
+    }
+
+    if (NULL == (f = fopen (argv[1], "rb")) || 0 != fseek (f, 0, SEEK_END) ||
+        0 > (size = ftell (f)) || 0 != fseek (f, 0, SEEK_SET)) {
+        perror (argv[1]);
+        return 1;
+    }
+    img = malloc (size);
+    if (NULL == img || (size_t)size != fread (img, 1, size, f)) {
+        perror (argv[1]);
+        return 1;
+    }
+    fclose (f);
+
+    n_inodes = read32 (img + 4);
+    n_blocks = read32 (img + 8);
+    header = (n_inodes + 1) * BLOCK_SIZE;
+    if (size < BLOCK_SIZE || header + (uint64_t)n_blocks * BLOCK_SIZE > (uint64_t)size) {
+        fprintf (stderr, "%s: not a filesystem image\n", argv[1]);
+        return 1;
+    }
+    if (0 == memcmp (img + STATS_RESERVED, cfs_magic, sizeof (cfs_magic))) {
+        fprintf (stderr, "%s: already compressed\n", argv[1]);
+        return 1;
+    }
+
+    /* worst case every block is stored as is */
+    table = (n_blocks + 1) * 4;
+    out = malloc (header + table + n_blocks * BLOCK_SIZE);
+    block = malloc (2 * BLOCK_SIZE);
+    check = malloc (BLOCK_SIZE);
+    if (NULL == out || NULL == block || NULL == check) {
+        fprintf (stderr, "out of memory\n");
+        return 1;
+    }
+    memcpy (out, img, header);
+    memcpy (out + STATS_RESERVED, cfs_magic, sizeof (cfs_magic));
+
+    pos = table;
+    for (i = 0; i < n_blocks; i++) {
+        write32 (out + header + i * 4, pos);
+        clen = lz4_compress (img + header + i * BLOCK_SIZE, BLOCK_SIZE, block);
+        if (clen >= BLOCK_SIZE) {
+            memcpy (out + header + pos, img + header + i * BLOCK_SIZE, BLOCK_SIZE);
+            pos += BLOCK_SIZE;
+        } else {
+            memcpy (out + header + pos, block, clen);
+            pos += clen;
+        }
+    }
+    write32 (out + header + n_blocks * 4, pos);
+
+    /* check every block and time reading the data region both ways */
+    t = seconds ();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+        for (i = 0; i < n_blocks; i++) {
+            memcpy (check, img + header + i * BLOCK_SIZE, BLOCK_SIZE);
+            sink += check[i % BLOCK_SIZE];
+        }
+    t_plain = seconds () - t;
+
+    t = seconds ();
+    for (round = 0; round < BENCH_ROUNDS; round++)
+        for (i = 0; i < n_blocks; i++) {
+            uint32_t start = read32 (out + header + i * 4);
+            uint32_t end = read32 (out + header + i * 4 + 4);
+            if (BLOCK_SIZE == end - start)
+                memcpy (check, out + header + start, BLOCK_SIZE);
+            else if (BLOCK_SIZE != lz4_decompress (out + header + start, end - start,
+                                                   check, BLOCK_SIZE)) {
+                fprintf (stderr, "block %u does not inflate\n", i);
+                return 1;
+            }
+            if (0 == round && 0 != memcmp (check, img + header + i * BLOCK_SIZE, BLOCK_SIZE)) {
+                fprintf (stderr, "block %u does not round trip\n", i);
+                return 1;
+            }
+            sink += check[i % BLOCK_SIZE];
+        }
+    t_lz4 = seconds () - t;
+
+    if (NULL == (f = fopen (argv[2], "wb")) ||
+        header + pos != fwrite (out, 1, header + pos, f) || 0 != fclose (f)) {
+        perror (argv[2]);
+        return 1;
+    }
+
+    printf ("%u data blocks: %u bytes -> %u bytes (%.1f%%), image %ld -> %u bytes\n",
+            n_blocks, n_blocks * BLOCK_SIZE, pos, 100.0 * pos / (n_blocks * BLOCK_SIZE),
+            size, header + pos);
+    printf ("read every block %d times: plain %.1f MB/s, compressed %.1f MB/s\n",
+            BENCH_ROUNDS, BENCH_ROUNDS * n_blocks * (double)BLOCK_SIZE / t_plain / 1e6,
+            BENCH_ROUNDS * n_blocks * (double)BLOCK_SIZE / t_lz4 / 1e6);
+    return 0;
+}
@@ -2,6 +2,8 @@
 
 #include "file_system.h"
 #include "system_calls.h"
+#include "paging.h"
+#include "syscall_stats.h"
 
 #define FS_BLOCK 4096 // There are 4kb or 4096 bytes per block 
 #define MAX_DENTRIES 63
@@ -10,7 +12,20 @@
 #define NOT_IN_USE 0
 #define FSOPEN 1
 #define FSCLOSED 0
-#define FNAMESIZE 32
+#define DENTRY_HASH_SIZE 128 // power of two, at least twice MAX_DENTRIES
+#define FNV_OFFSET 2166136261U
+#define FNV_PRIME 16777619U
+#define MAX_INODES 256 // inodes that get an extent map
+#define MAX_EXTENTS 2048 // runs shared by all mapped inodes
+#define MAX_FILE_BLOCKS 1023 // data block slots in an inode
+#define ENTRY_POINT_OFFSET 24
+#define REGULAR_FILE 2
+#define PROGRAM_START 0x08000000 // the 4MB program page every image runs in
+#define PROGRAM_END 0x08400000
+#define VIRTUAL_DENTRIES 1 // dentries after the image's own, the statistics file
+#define FS_CACHE_SLOTS 16 // decompressed blocks kept for a compressed image
+#define LZ4_MIN_MATCH 4
+#define FS_BOOT_BENCHMARK 0 // 1 to time fs_init and a read of every file at boot
 
 dentry_t* fs_dentries;
 system_stats* fs_stats;
@@ -21,9 +36,48 @@ uint32_t n_inodes;
 uint32_t n_dentries;
 uint32_t n_data_blocks;
 int32_t fs_is_open = 0;
+uint32_t fs_blocks_mappable = 0; // data blocks are page aligned and can be mapped into user space
 
 int32_t current_dentry = 0;
 
+dentry_hash_slot dentry_hash[DENTRY_HASH_SIZE];
+
+uint32_t fs_lookups = 0;
+uint32_t fs_lookup_compares = 0;
+uint32_t fs_last_lookup_compares = 0;
+
+extent_t fs_extents[MAX_EXTENTS];
+inode_extent_map fs_extent_maps[MAX_INODES];
+uint32_t n_extents = 0;
+
+exec_info_t exec_cache[MAX_INODES];
+uint32_t exec_cache_hits = 0;
+uint32_t exec_cache_misses = 0;
+
+static const uint8_t exec_magic[4] = {0x7F, 'E', 'L', 'F'};
+
+/* Compressed images carry this in the first reserved bytes of the boot block. Their
+   data region starts with num_data_blocks + 1 offsets, relative to the region,
+   bounding each block's LZ4 data. A block FS_BLOCK bytes long is stored as is */
+static const uint8_t cfs_magic[4] = {'C', 'F', 'S', '1'};
+
+uint32_t fs_compressed = 0;
+uint32_t* fs_block_offsets;
+uint32_t fs_data_size;
+
+uint8_t fs_cache[FS_CACHE_SLOTS][FS_BLOCK] __attribute__((aligned(FS_BLOCK)));
+uint32_t fs_cache_tags[FS_CACHE_SLOTS]; // block number + 1, 0 for an empty slot
+uint32_t fs_cache_hits = 0;
+uint32_t fs_cache_misses = 0;
+
+static uint32_t fname_length(const uint8_t* fname);
+static uint32_t fname_hash(const uint8_t* fname, uint32_t length);
+static void build_dentry_hash(void);
+static void build_extent_maps(void);
+static int32_t inode_run(uint32_t inode, uint32_t file_block, uint32_t* first_block, uint32_t* num_blocks);
+static uint8_t* fs_block(uint32_t block);
+static int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+static void fs_benchmark(uint32_t init_cycles);
 
 
 
@@ -38,10 +92,13 @@ int32_t current_dentry = 0;
 
 void fs_init(module_t module){
 	
+	uint32_t i;
+	uint32_t start_tsc;
 	dentry_t* fs_dentry_start;
 	inode* fs_inode_start;
 	uint8_t* fs_data_blocks_start;
 
+	start_tsc = rdtsc();
 
 	fs_stats = (system_stats*)module.mod_start;
 
@@ -58,62 +115,539 @@ void fs_init(module_t module){
 	fs_inodes = fs_inode_start;
 	fs_data_blocks = fs_data_blocks_start;
 
+	/* GRUB page aligns modules, so blocks are normally page aligned too */
+	fs_blocks_mappable = (((uint32_t)fs_data_blocks & (FS_BLOCK - 1)) == 0);
+
+	/* blocks of a compressed image are inflated on first use, into fs_cache */
+	fs_compressed = (strncmp((int8_t*)fs_stats->reserved, (int8_t*)cfs_magic, sizeof(cfs_magic)) == 0);
+	if(fs_compressed){
 
+		fs_block_offsets = (uint32_t*)fs_data_blocks;
+		fs_data_size = module.mod_end - (uint32_t)fs_data_blocks;
+		fs_blocks_mappable = 0;
+		for(i = 0; i < FS_CACHE_SLOTS; i++)
+			fs_cache_tags[i] = 0;
+	}
+
+	/* the boot block only has room for MAX_DENTRIES entries */
+	if(n_dentries > MAX_DENTRIES)
+		n_dentries = MAX_DENTRIES;
+
+	build_dentry_hash();
+	build_extent_maps();
+
+	for(i = 0; i < MAX_INODES; i++)
+		exec_cache[i].valid = 0;
+
+	if(FS_BOOT_BENCHMARK)
+		fs_benchmark(rdtsc() - start_tsc);
 }
 
 /*
-*  fs_load
-*	 DESCRIPTION: Loads file system data into user memory
-*	 INPUTS: File name and virtual address of the user space
+*  fs_benchmark
+*	 DESCRIPTION: Prints how long fs_init took and times one read of every file
+*	 INPUTS: Cycles fs_init took
+*	 OUTPUTS: Prints the numbers to the screen
+*	 RETURN VALUE: none
+*	 SIDE EFFECTS: Fills the block cache of a compressed image
+*/
+
+static void fs_benchmark(uint32_t init_cycles){
+
+	static uint8_t scratch[FS_BLOCK];
+	uint32_t i;
+	uint32_t offset;
+	uint32_t bytes;
+	uint32_t start_tsc;
+	int32_t ret;
+
+	bytes = 0;
+	start_tsc = rdtsc();
+	for(i = 0; i < n_inodes; i++){
+
+		offset = 0;
+		while((ret = read_data(i, offset, scratch, FS_BLOCK)) > 0)
+			offset += ret;
+		bytes += offset;
+	}
+
+	printf("fs: %s image, init %u cycles, read %u bytes in %u cycles\n",
+		fs_compressed ? "compressed" : "plain", init_cycles, bytes, rdtsc() - start_tsc);
+}
+
+/*
+*  fname_length
+*	 DESCRIPTION: Finds the length of a file name, looking at no more than FNAMESIZE + 1 bytes
+*	 INPUTS: File name, which is not NUL terminated when it is exactly FNAMESIZE long
 *	 OUTPUTS: none
-*	 RETURN VALUE: 0 on success and -1 on failure
-*	 SIDE EFFECTS: none
+*	 RETURN VALUE: Length of the name, FNAMESIZE + 1 if the name is too long to be a file name
+*	 SIDE EFFECTS: None
 */
 
+static uint32_t fname_length(const uint8_t* fname){
 
-int32_t fs_load(const uint8_t* fname, uint32_t address){
+	uint32_t length;
 
-	dentry_t temp_dentry;
-	if(fname == NULL)
-		return -1;
-	int32_t error;
-	error = read_dentry_by_name(fname, &temp_dentry);
-	if(error == -1){
+	for(length = 0; length <= FNAMESIZE && fname[length] != '\0'; length++);
 
-		return -1;
+	return length;
+}
+
+/*
+*  fname_hash
+*	 DESCRIPTION: FNV-1a hash of the first length bytes of a file name
+*	 INPUTS: File name and its length
+*	 OUTPUTS: none
+*	 RETURN VALUE: 32 bit hash of the name
+*	 SIDE EFFECTS: None
+*/
+
+static uint32_t fname_hash(const uint8_t* fname, uint32_t length){
+
+	uint32_t i;
+	uint32_t hash;
+
+	hash = FNV_OFFSET;
+	for(i = 0; i < length; i++){
+
+		hash ^= fname[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/*
+*  build_dentry_hash
+*	 DESCRIPTION: Builds the open-addressed name index used by read_dentry_by_name,
+*				  precomputing every dentry's name length
+*	 INPUTS: none
+*	 OUTPUTS: Fills dentry_hash
+*	 RETURN VALUE: none
+*	 SIDE EFFECTS: When the image holds duplicate names only the first one is indexed,
+*				   matching the old linear scan
+*/
+
+static void build_dentry_hash(void){
+
+	uint32_t i;
+	uint32_t slot;
+	uint32_t length;
+	int32_t duplicate;
+
+	for(i = 0; i < DENTRY_HASH_SIZE; i++)
+		dentry_hash[i].in_use = NOT_IN_USE;
+
+	for(i = 0; i < n_dentries; i++){
+
+		length = fname_length(fs_dentries[i].f_name);
+		if(length == 0)
+			continue;
+		if(length > FNAMESIZE)	// name fills the whole field with no terminator
+			length = FNAMESIZE;
+
+		duplicate = 0;
+		slot = fname_hash(fs_dentries[i].f_name, length) & (DENTRY_HASH_SIZE - 1);
+
+		while(dentry_hash[slot].in_use == IN_USE){
+
+			if(dentry_hash[slot].name_len == length &&
+				0 == strncmp((int8_t*)fs_dentries[dentry_hash[slot].dentry_idx].f_name, (int8_t*)fs_dentries[i].f_name, length)){
+
+				duplicate = 1;
+				break;
+			}
+			slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
+		}
+
+		if(duplicate)
+			continue;
+
+		dentry_hash[slot].in_use = IN_USE;
+		dentry_hash[slot].name_len = length;
+		dentry_hash[slot].dentry_idx = i;
+	}
+}
+
+/*
+*  build_extent_maps
+*	 DESCRIPTION: Groups every inode's physically contiguous data blocks into runs so
+*				  read_data can copy a whole run at once
+*	 INPUTS: none
+*	 OUTPUTS: Fills fs_extents and fs_extent_maps
+*	 RETURN VALUE: none
+*	 SIDE EFFECTS: Inodes past MAX_INODES, or found after the pool is full, are left
+*				   unmapped and read_data finds their runs on the fly instead
+*/
+
+static void build_extent_maps(void){
+
+	uint32_t i, j;
+	uint32_t num_blocks;
+	uint32_t block;
+	inode_extent_map* map;
+	extent_t* run;
+
+	n_extents = 0;
+
+	for(i = 0; i < n_inodes && i < MAX_INODES; i++){
+
+		map = &fs_extent_maps[i];
+		map->first_extent = n_extents;
+		map->num_extents = 0;
+		map->mapped = 1;
+		map->bad = 0;
+
+		num_blocks = (fs_inodes[i].length + FS_BLOCK - 1) / FS_BLOCK;
+		if(num_blocks > MAX_FILE_BLOCKS){
+
+			map->bad = 1;
+			num_blocks = MAX_FILE_BLOCKS;
+		}
+
+		run = NULL;
+		for(j = 0; j < num_blocks; j++){
+
+			block = fs_inodes[i].data_block_idx[j];
+			if(block >= n_data_blocks){
+
+				map->bad = 1;
+				break;
+			}
+
+			/* extend the current run while the next block follows it on disk */
+			if(run != NULL && block == run->first_block + run->num_blocks){
+
+				run->num_blocks++;
+				continue;
+			}
+
+			if(n_extents == MAX_EXTENTS){
+
+				map->mapped = 0;
+				break;
+			}
+
+			run = &fs_extents[n_extents++];
+			run->file_block = j;
+			run->first_block = block;
+			run->num_blocks = 1;
+			map->num_extents++;
+		}
+
+		/* give back the runs of a partially mapped inode */
+		if(map->mapped == 0){
+
+			n_extents = map->first_extent;
+			map->num_extents = 0;
+		}
+	}
+}
+
+/*
+*  inode_run
+*	 DESCRIPTION: Finds the run of contiguous data blocks that holds a given block of a file
+*	 INPUTS: Inode index, block index within the file, and pointers to return the run in
+*	 OUTPUTS: first_block gets the data block holding file_block, num_blocks gets the
+*			  number of contiguous blocks from there to the end of the run
+*	 RETURN VALUE: 0 on success and -1 if the block is not part of a valid file
+*	 SIDE EFFECTS: None
+*/
+
+static int32_t inode_run(uint32_t inode, uint32_t file_block, uint32_t* first_block, uint32_t* num_blocks){
+
+	inode_extent_map* map;
+	extent_t* run;
+	uint32_t low, high, mid;
+	uint32_t file_blocks;
+	uint32_t block;
+
+	if(inode < MAX_INODES){
+
+		map = &fs_extent_maps[inode];
+		if(map->bad || (map->mapped && map->num_extents == 0))
+			return -1;
+
+		if(map->mapped){
+
+			/* binary search for the last run starting at or before file_block */
+			low = 0;
+			high = map->num_extents;
+			while(high - low > 1){
+
+				mid = (low + high) / 2;
+				if(fs_extents[map->first_extent + mid].file_block <= file_block)
+					low = mid;
+				else
+					high = mid;
+			}
+
+			run = &fs_extents[map->first_extent + low];
+			if(file_block < run->file_block || file_block >= run->file_block + run->num_blocks)
+				return -1;
+
+			*first_block = run->first_block + (file_block - run->file_block);
+			*num_blocks = run->num_blocks - (file_block - run->file_block);
+			return 0;
+		}
 	}
 
-	if( -1 == read_data(temp_dentry.inode_num, 0, (uint8_t*) 0x08048000, fs_inodes[temp_dentry.inode_num].length)){
+	/* no map for this inode, walk its block list from file_block */
+	file_blocks = (fs_inodes[inode].length + FS_BLOCK - 1) / FS_BLOCK;
+	if(file_blocks > MAX_FILE_BLOCKS)
+		file_blocks = MAX_FILE_BLOCKS;
+	if(file_block >= file_blocks)
+		return -1;
 
+	block = fs_inodes[inode].data_block_idx[file_block];
+	if(block >= n_data_blocks)
 		return -1;
+
+	*first_block = block;
+	*num_blocks = 1;
+	while(file_block + *num_blocks < file_blocks &&
+		fs_inodes[inode].data_block_idx[file_block + *num_blocks] == block + *num_blocks &&
+		block + *num_blocks < n_data_blocks){
+
+		(*num_blocks)++;
 	}
 
 	return 0;
 }
 
 /*
-*  fs_read
-*	 DESCRIPTION: Reads file system, particulary used to find entry point in system execute
-*	 INPUTS: File name, buffer to write into, offset within the file system, and number of bytes to read
-*	 OUTPUTS: Writes to the buffer that is provided as a parameter
-*	 RETURN VALUE: Number of bytes read on success and -1 on failure
-*	 SIDE EFFECTS: none
+*  fs_block
+*	 DESCRIPTION: Finds a data block of a compressed image, inflating it into the
+*				  block cache if it is not there already
+*	 INPUTS: Data block number
+*	 OUTPUTS: May replace a block in the cache
+*	 RETURN VALUE: Address of the block's FS_BLOCK bytes, NULL if the block is
+*				   out of range or its data is corrupt
+*	 SIDE EFFECTS: Counts cache hits and misses
 */
 
-int32_t fs_read(const uint8_t* fname, uint8_t * buf, uint32_t offset, uint32_t nbytes){
+static uint8_t* fs_block(uint32_t block){
+
+	uint32_t slot;
+	uint32_t start;
+	uint32_t end;
+
+	if(block >= n_data_blocks)
+		return NULL;
+
+	/* direct mapped, each block can only live in one slot */
+	slot = block % FS_CACHE_SLOTS;
+	if(fs_cache_tags[slot] == block + 1){
+
+		fs_cache_hits++;
+		return fs_cache[slot];
+	}
+	fs_cache_misses++;
+
+	start = fs_block_offsets[block];
+	end = fs_block_offsets[block + 1];
+	if(start > end || end > fs_data_size)
+		return NULL;
+
+	fs_cache_tags[slot] = 0;
+	if(end - start == FS_BLOCK)
+		memcpy((void*)fs_cache[slot], (void*)(fs_data_blocks + start), FS_BLOCK);
+	else if(lz4_decompress(fs_data_blocks + start, end - start, fs_cache[slot], FS_BLOCK) != FS_BLOCK)
+		return NULL;
+
+	fs_cache_tags[slot] = block + 1;
+	return fs_cache[slot];
+}
+
+/*
+*  lz4_decompress
+*	 DESCRIPTION: Inflates one LZ4 block: a series of sequences, each a token whose
+*				  high nibble counts literals and low nibble the match length minus 4,
+*				  either one extended by bytes of 255, the literals, and a two byte
+*				  little endian match offset. The last sequence has no match
+*	 INPUTS: Compressed data and its length, output buffer and its size
+*	 OUTPUTS: Writes the inflated data to dst
+*	 RETURN VALUE: Number of bytes written, -1 if the data is corrupt or does not fit
+*	 SIDE EFFECTS: None
+*/
+
+static int32_t lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len){
+
+	const uint8_t* ip;
+	const uint8_t* ip_end;
+	uint8_t* op;
+	uint8_t* op_end;
+	const uint8_t* match;
+	uint32_t token;
+	uint32_t length;
+	uint32_t offset;
+	uint32_t byte;
+
+	ip = src;
+	ip_end = src + src_len;
+	op = dst;
+	op_end = dst + dst_len;
+
+	while(ip < ip_end){
+
+		token = *ip++;
+
+		/* literals */
+		length = token >> 4;
+		if(length == 15){
+			do{
+				if(ip >= ip_end)
+					return -1;
+				byte = *ip++;
+				length += byte;
+			} while(byte == 255);
+		}
+		if(length > (uint32_t)(ip_end - ip) || length > (uint32_t)(op_end - op))
+			return -1;
+		memcpy((void*)op, (void*)ip, length);
+		ip += length;
+		op += length;
+
+		if(ip == ip_end)
+			break;
+
+		/* match */
+		if(ip_end - ip < 2)
+			return -1;
+		offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if(offset == 0 || offset > (uint32_t)(op - dst))
+			return -1;
+
+		length = (token & 0x0F);
+		if(length == 15){
+			do{
+				if(ip >= ip_end)
+					return -1;
+				byte = *ip++;
+				length += byte;
+			} while(byte == 255);
+		}
+		length += LZ4_MIN_MATCH;
+		if(length > (uint32_t)(op_end - op))
+			return -1;
+
+		/* byte at a time, the match may overlap what it is copying */
+		match = op - offset;
+		while(length-- > 0)
+			*op++ = *match++;
+	}
+
+	return op - dst;
+}
+
+/*
+*  fs_exec_lookup
+*	 DESCRIPTION: Finds everything sys_execute needs to start a program. The checked
+*				  header, entry point, length and dentry are cached by inode so a program
+*				  that is run again only costs the name lookup
+*	 INPUTS: File name and a structure to copy the program's information into
+*	 OUTPUTS: Fills exe
+*	 RETURN VALUE: 0 on success and -1 if the name is not an executable regular file
+*	 SIDE EFFECTS: Counts a cache hit or miss
+*/
+
+int32_t fs_exec_lookup(const uint8_t* fname, exec_info_t* exe){
 
 	dentry_t temp_dentry;
-	if(fname == NULL){
+	uint8_t magic[sizeof(exec_magic)];
+	uint8_t entry[sizeof(uint32_t)];
+	uint32_t entry_point;
 
+	if(fname == NULL || exe == NULL)
 		return -1;
+
+	if(read_dentry_by_name(fname, &temp_dentry) == -1 || temp_dentry.f_type != REGULAR_FILE)
+		return -1;
+
+	if(temp_dentry.inode_num < MAX_INODES && exec_cache[temp_dentry.inode_num].valid){
+
+		exec_cache_hits++;
+		*exe = exec_cache[temp_dentry.inode_num];
+		return 0;
 	}
 
-	if(  read_dentry_by_name(fname, &temp_dentry) == -1){
+	exec_cache_misses++;
 
+	/* only the magic and the entry point are needed, read each at its offset */
+	if(read_data(temp_dentry.inode_num, 0, magic, sizeof(magic)) != sizeof(magic))
+		return -1;
+
+	if(strncmp((int8_t*)magic, (int8_t*)exec_magic, sizeof(exec_magic)) != 0)
+		return -1;
+
+	if(read_data(temp_dentry.inode_num, ENTRY_POINT_OFFSET, entry, sizeof(entry)) != sizeof(entry))
+		return -1;
+
+	entry_point = entry[0] | (entry[1] << 8) | (entry[2] << 16) | (entry[3] << 24);
+
+	if(entry_point < PROGRAM_START || entry_point >= PROGRAM_END)
+		return -1;
+
+	// the image may not reach the mmap window
+	if(fs_inodes[temp_dentry.inode_num].length > MMAP_START - IMAGE_MEM)
+		return -1;
+
+	exe->valid = 1;
+	exe->dentry = temp_dentry;
+	exe->length = fs_inodes[temp_dentry.inode_num].length;
+	exe->entry_point = entry_point;
+
+	if(temp_dentry.inode_num < MAX_INODES)
+		exec_cache[temp_dentry.inode_num] = *exe;
+
+	return 0;
+}
+
+/*
+*  fs_file_length
+*	 DESCRIPTION: Looks up the size of a file
+*	 INPUTS: Inode index
+*	 OUTPUTS: None
+*	 RETURN VALUE: Length of the file in bytes, -1 for a bad inode
+*	 SIDE EFFECTS: None
+*/
+
+int32_t fs_file_length(uint32_t inode){
+
+	if(inode >= n_inodes)
+		return -1;
+
+	return fs_inodes[inode].length;
+}
+
+/*
+*  fs_page_block
+*	 DESCRIPTION: Finds the data block holding a whole page of a file so it can be mapped
+*				  straight into user space instead of copied
+*	 INPUTS: Inode index, page aligned offset within the file, pointer to return the block in
+*	 OUTPUTS: block_addr gets the address of the data block
+*	 RETURN VALUE: 0 on success and -1 if the page cannot be mapped, because it runs past
+*				   the end of the file or the blocks are not page aligned
+*	 SIDE EFFECTS: None
+*/
+
+int32_t fs_page_block(uint32_t inode, uint32_t offset, uint32_t* block_addr){
+
+	uint32_t first_block;
+	uint32_t num_blocks;
+
+	if(!fs_blocks_mappable || inode >= n_inodes || (offset % FS_BLOCK) != 0)
+		return -1;
+
+	if(offset + FS_BLOCK > fs_inodes[inode].length)
+		return -1;
+
+	if(inode_run(inode, offset / FS_BLOCK, &first_block, &num_blocks) == -1)
 		return -1;
-	}
 
-	return read_data(temp_dentry.inode_num, offset, buf, nbytes );
+	*block_addr = (uint32_t)(fs_data_blocks + first_block * FS_BLOCK);
+	return 0;
 }
 
 /*
@@ -160,7 +694,8 @@ int32_t fs_close(){
 
 /*
 *  read_dentry_by_name
-*	 DESCRIPTION: Looks for directory entry associated with the file name
+*	 DESCRIPTION: Looks for directory entry associated with the file name using the
+*				  hashed name index, counting the name comparisons each lookup does
 *	 INPUTS: A string of the file name and a pointer to a dentry structure
 *	 OUTPUTS: Copies correct dentry to the dentry pointer passed
 *	 RETURN VALUE: 0 on success and -1 on failure
@@ -171,35 +706,40 @@ int32_t fs_close(){
 
 int32_t read_dentry_by_name(const uint8_t* fname, dentry_t* dentry){
 
-	int i, j;
-
 	uint32_t length;
+	uint32_t slot;
+	uint32_t idx;
 
-	
-	length = strlen((char*)fname);
-
-	
+	if(fname == NULL || dentry == NULL)
+		return -1;
 
-	for( i = 0; i < n_dentries; i++){
+	fs_lookups++;
+	fs_last_lookup_compares = 0;
 
-		if(length == strlen((char*)fs_dentries[i].f_name)){
+	length = fname_length(fname);
+	if(length == 0 || length > FNAMESIZE)
+		return -1;
 
-			if(0 == strncmp((int8_t*)fname, (int8_t*)fs_dentries[i].f_name, length)){
-				for( j = 0; j < FNAMESIZE; j++){
+	slot = fname_hash(fname, length) & (DENTRY_HASH_SIZE - 1);
 
-				dentry->f_name[j] = fs_dentries[i].f_name[j];
+	/* linear probing, the table is at most half full so an empty slot always ends the search */
+	while(dentry_hash[slot].in_use == IN_USE){
 
-				}
-				dentry->f_type = fs_dentries[i].f_type;
-				dentry->inode_num = fs_dentries[i].inode_num;
-				return 0;
-			}
-		}
+		if(dentry_hash[slot].name_len == length){
 
+			fs_last_lookup_compares++;
+			fs_lookup_compares++;
+			idx = dentry_hash[slot].dentry_idx;
 
-		
+			if(0 == strncmp((int8_t*)fname, (int8_t*)fs_dentries[idx].f_name, length))
+				return read_dentry_by_index(idx, dentry);
+		}
+		slot = (slot + 1) & (DENTRY_HASH_SIZE - 1);
 	}
 
+	if(length == sizeof(STATS_NAME) - 1 && 0 == strncmp((int8_t*)fname, (int8_t*)STATS_NAME, length))
+		return read_dentry_by_index(n_dentries, dentry);
+
 	return -1;
 
 
@@ -228,6 +768,15 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
 
 	}
 
+	/* the statistics file comes after every real entry */
+	if(index == n_dentries){
+				memset((void*)dentry->f_name, 0, FNAMESIZE);
+				strncpy((int8_t*)dentry->f_name, (int8_t*)STATS_NAME, FNAMESIZE);
+				dentry->f_type = STATS_FILE;
+				dentry->inode_num = 0;
+				return 0;
+	}
+
 	else
 		return -1;
 
@@ -238,7 +787,8 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
 
 /*
 *  read_data
-*	 DESCRIPTION: Reads the data for a file provided by a particular inode
+*	 DESCRIPTION: Reads the data for a file provided by a particular inode, issuing one
+*				  copy per run of physically contiguous data blocks
 *	 INPUTS: Index to the correct inode, offset within the file_system, a buffer to write to, and the amount of bytes to copy
 *	 OUTPUTS: Writes file data to the passed buffer
 *	 RETURN VALUE: Number of bytes read on success and -1 on failure
@@ -247,17 +797,9 @@ int32_t read_dentry_by_index(uint32_t index, dentry_t* dentry){
 
 int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length){
 
-	int i;
-	i = 0;
-
-	
-
-	uint32_t current; /*used to keep track of current data block*/
-	uint32_t current_idx; /* keeps track of current data block # specified in inode*/
-	uint32_t inode_length; /* used to keep track of the length of the file in bites*/
 	uint32_t ret_bytes; /*keep track of the number of bytes that are copied to the buffer*/
-	uint32_t offset_in_block; /*Offset within the block*/
-	
+	int32_t chunk; /* bytes copied out of the current run*/
+	uint8_t* src; /* where the run's data is*/
 
 	/*check if inode # exists*/
 
@@ -265,79 +807,87 @@ int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t length
 
 		return -1;
 	}
-	//finds number of bytes in fyle
-	inode_length = fs_inodes[inode].length; 
 
 	/* Check if the offset is out of bounds*/
 
-	if(offset > inode_length){
+	if(offset >= fs_inodes[inode].length){
 
 		return 0;
 
 	}
 
-	
-	/*calculate the data block and location within in the block to start at*/
-	current = (offset / FS_BLOCK);
-	offset_in_block = (offset % FS_BLOCK); 
-
-	/* copy bytes of data blocks to buffer*/
+	/* never read past the end of the file*/
+	if(length > fs_inodes[inode].length - offset)
+		length = fs_inodes[inode].length - offset;
 
-	current_idx = (FS_BLOCK * fs_inodes[inode].data_block_idx[current]) + offset_in_block;
-	
-	
-	if((length > (FS_BLOCK - offset_in_block)) && ((FS_BLOCK - offset_in_block + offset) <= inode_length)){
-		memcpy((void*)(buf), (void*)(fs_data_blocks + current_idx), FS_BLOCK - offset_in_block);
-		ret_bytes = FS_BLOCK - offset_in_block;
-	}
+	/* copy one whole run of contiguous data blocks per memcpy*/
+	ret_bytes = 0;
+	while(ret_bytes < length){
 
-	else if((length == FS_BLOCK - offset_in_block) && (length < (inode_length - offset))){
+		chunk = fs_data_run(inode, offset + ret_bytes, &src);
+		if(chunk <= 0)
+			return -1;
+		if(chunk > length - ret_bytes)
+			chunk = length - ret_bytes;
 
-		memcpy((void*)(buf), (void*)(fs_data_blocks + current_idx), length);
-		return length;
+		memcpy((void*)(buf + ret_bytes), (void*)src, chunk);
+		ret_bytes += chunk;
 	}
 
+	return ret_bytes;
 
-	else if((length < (inode_length - offset)) && ((length + offset_in_block) < FS_BLOCK)){
-		memcpy((void*)(buf), (void*)(fs_data_blocks + current_idx), length);
-		return length;
-	}
 
-	else{
-		memcpy((void*)(buf), (void*)(fs_data_blocks + current_idx), inode_length - offset);
-		return (inode_length - offset);
-	}
+}
 
-	current++;
-	current_idx = (FS_BLOCK * fs_inodes[inode].data_block_idx[current]);
+/*
+*  fs_data_run
+*	 DESCRIPTION: Finds the file data at an offset in place, so it can be used without
+*				  being copied. For a plain image that is the rest of the run of
+*				  contiguous data blocks, for a compressed one the rest of the block,
+*				  inflated in the block cache
+*	 INPUTS: Index to the inode, offset within the file, pointer to return the data in
+*	 OUTPUTS: data gets the address of the byte at offset
+*	 RETURN VALUE: Number of bytes that can be used at data, never past the end of the
+*				   file, 0 at or past the end of the file, and -1 on failure
+*	 SIDE EFFECTS: A compressed block stays valid only until the next block is inflated
+*/
 
-	while(ret_bytes < length){
+int32_t fs_data_run(uint32_t inode, uint32_t offset, uint8_t** data){
 
+	uint32_t first_block; /* data block the current run starts at*/
+	uint32_t num_blocks; /* blocks left in the current run*/
+	uint32_t offset_in_block; /*Offset within the first block of the run*/
+	uint32_t chunk; /* bytes left in the run*/
+	uint8_t* src;
 
-		if( (length > FS_BLOCK + ret_bytes) && (inode_length > FS_BLOCK + ret_bytes)){
-		memcpy((void*)(buf + ret_bytes), (void*)(fs_data_blocks + current_idx), FS_BLOCK);
-		ret_bytes += FS_BLOCK;
-		current++;
-		current_idx = (FS_BLOCK * fs_inodes[inode].data_block_idx[current]);
+	if(inode >= n_inodes || data == NULL)
+		return -1;
 
-		}
-		else if ((length + offset) < inode_length  && (length - ret_bytes) < FS_BLOCK){
-		memcpy((void*)(buf + ret_bytes), (void*)(fs_data_blocks + current_idx), length - ret_bytes);
-		return length;
+	if(offset >= fs_inodes[inode].length)
+		return 0;
 
+	if(inode_run(inode, offset / FS_BLOCK, &first_block, &num_blocks) == -1)
+		return -1;
 
-		}
-		else{
-		memcpy((void*)(buf + ret_bytes), (void*)(fs_data_blocks + current_idx), inode_length - ret_bytes - offset);
-		return (inode_length - offset);
+	offset_in_block = offset % FS_BLOCK;
+	chunk = num_blocks * FS_BLOCK - offset_in_block;
 
+	/* a compressed image is inflated one block at a time */
+	if(fs_compressed){
 
-		}
+		src = fs_block(first_block);
+		if(src == NULL)
+			return -1;
+		chunk = FS_BLOCK - offset_in_block;
 	}
+	else
+		src = fs_data_blocks + first_block * FS_BLOCK;
 
-	return ret_bytes;
-
+	if(chunk > fs_inodes[inode].length - offset)
+		chunk = fs_inodes[inode].length - offset;
 
+	*data = src + offset_in_block;
+	return chunk;
 }
 
 /*
@@ -363,41 +913,103 @@ int32_t file_open(const uint8_t* filename){
 *	 INPUTS: File direcotry array index, buffer to write to, and number of bytes read
 *	 OUTPUTS: Copies file data to passed buffer
 *	 RETURN VALUE: Number of bytes read on success and -1 on failure
-*	 SIDE EFFECTS: None
+*	 SIDE EFFECTS: Moves the file position past the bytes read
 */
 
 int32_t file_read(int32_t fd, uint8_t* buf, int32_t nbytes){
 
-
-	//dentry_t temp_dentry;
-
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 
 	int32_t ret_bytes;
 
-	if(control_block->fd_array[fd].inode_ptr == -1){
+	ret_bytes = file_pread(fd, buf, nbytes, control_block->fd_array[fd].position);
+	if(ret_bytes > 0)
+		control_block->fd_array[fd].position += ret_bytes;
 
-		return -1;
-	}
+	return ret_bytes;
+}
 
-	if( control_block->fd_array[fd].position == fs_inodes[control_block->fd_array[fd].inode_ptr].length){
+/*
+*  file_pread
+*	 DESCRIPTION: Reads the data of a file at a given offset, without using or moving
+*				  the file position. Like read_data, but copies out to a user buffer
+*	 INPUTS: File directory array index, user buffer to write to, number of bytes to
+*			 read, and offset within the file
+*	 OUTPUTS: Copies file data to passed buffer
+*	 RETURN VALUE: Number of bytes read, 0 at or past the end of the file, -1 on failure
+*	 SIDE EFFECTS: None
+*/
 
-		return 0;
-	}
+int32_t file_pread(int32_t fd, uint8_t* buf, int32_t nbytes, uint32_t offset){
 
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
 
-	ret_bytes = read_data(control_block->fd_array[fd].inode_ptr, control_block->fd_array[fd].position, buf, nbytes);
+	int32_t ret_bytes;
+	int32_t chunk;
+	uint8_t* src;
 
-	control_block->fd_array[fd].position += ret_bytes;
+	if(nbytes < 0 || bad_userspace_addr(buf, nbytes))
+		return -1;
 
+	/* one copy per run of contiguous data blocks*/
+	ret_bytes = 0;
+	while(ret_bytes < nbytes){
+
+		chunk = fs_data_run(control_block->fd_array[fd].inode_ptr, offset + ret_bytes, &src);
+		if(chunk == -1)
+			return -1;
+		if(chunk == 0)
+			break;
+		if(chunk > nbytes - ret_bytes)
+			chunk = nbytes - ret_bytes;
+
+		if(copy_to_user(buf + ret_bytes, src, chunk) == -1)
+			return -1;
+		ret_bytes += chunk;
+	}
 
 	return ret_bytes;
+}
 
+/*
+*  file_lseek
+*	 DESCRIPTION: Moves the file position. It may be put past the end of the file,
+*				  reads there return 0
+*	 INPUTS: File directory array index, offset, and what the offset is relative to:
+*			 SEEK_SET the start of the file, SEEK_CUR the position, SEEK_END the end
+*	 OUTPUTS: none
+*	 RETURN VALUE: The new position, -1 if it would be negative or whence is bad
+*	 SIDE EFFECTS: Sets the file position
+*/
 
+int32_t file_lseek(int32_t fd, int32_t offset, int32_t whence){
 
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+
+	int32_t base;
+
+	switch(whence){
+		case SEEK_SET:
+			base = 0;
+			break;
+		case SEEK_CUR:
+			base = control_block->fd_array[fd].position;
+			break;
+		case SEEK_END:
+			base = fs_file_length(control_block->fd_array[fd].inode_ptr);
+			break;
+		default:
+			return -1;
+	}
 
+	if(base < 0 || (offset < 0 && base + offset < 0) || (offset > 0 && base + offset < base))
+		return -1;
 
+	control_block->fd_array[fd].position = base + offset;
+	return base + offset;
 }
 
 /*
@@ -450,8 +1062,8 @@ int32_t dir_open(const uint8_t* filename){
 *  dir_read
 *	 DESCRIPTION: Reads successive directory entries
 *	 INPUTS: File directory array index, character buffer, and bytes to write
-*	 OUTPUTS: none
-*	 RETURN VALUE: Bytes read on success and -1 on failure
+*	 OUTPUTS: Copies the name, padded with '\0' to FNAMESIZE, up to nbytes
+*	 RETURN VALUE: Length of the name on success and -1 on failure
 *	 SIDE EFFECTS: None
 */
 
@@ -461,11 +1073,12 @@ int32_t dir_read(int32_t fd, uint8_t* buf, int32_t nbytes){
 
 	
 	dentry_t temp_dentry;
+	int32_t name_len;
 
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 
-	if(control_block->fd_array[fd].position >= n_dentries){
+	if(control_block->fd_array[fd].position >= n_dentries + VIRTUAL_DENTRIES){
 
 		return 0;
 	}
@@ -476,13 +1089,87 @@ int32_t dir_read(int32_t fd, uint8_t* buf, int32_t nbytes){
 
 
 
-	memcpy((void*)(buf), (void*)(&temp_dentry), FNAMESIZE);
+	if(nbytes > FNAMESIZE)
+		nbytes = FNAMESIZE;
+
+	if(nbytes < 0 || copy_to_user(buf, temp_dentry.f_name, nbytes) == -1)
+		return -1;
 
 	control_block->fd_array[fd].position++;	
 
-	
-	return strlen((int8_t*)buf);
+	name_len = fname_length(temp_dentry.f_name);
+	return (name_len < nbytes) ? name_len : nbytes;
+
+}
+
+/*
+*  dir_getdents
+*	 DESCRIPTION: Reads as many successive directory entries as fit in the buffer, each
+*				  packed as a dirent_t record with its name, type, inode and size
+*	 INPUTS: File directory array index, buffer to fill, and size of the buffer
+*	 OUTPUTS: Writes the records to the buffer
+*	 RETURN VALUE: Bytes of records written, 0 once every entry has been read, and -1
+*				   if the buffer cannot hold even the next record
+*	 SIDE EFFECTS: Moves the directory position past the entries returned
+*/
+
+int32_t dir_getdents(int32_t fd, uint8_t* buf, int32_t nbytes){
+
+	dentry_t temp_dentry;
+	uint32_t record_buf[(sizeof(dirent_t) + FNAMESIZE + 1 + 3) / 4]; /* record is built here, then copied out*/
+	dirent_t* record;
+	uint32_t name_len;
+	uint32_t rec_len;
+	int32_t ret_bytes;
+
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
 
+	record = (dirent_t*)record_buf;
+	ret_bytes = 0;
+
+	while(control_block->fd_array[fd].position < n_dentries + VIRTUAL_DENTRIES){
+
+		read_dentry_by_index(control_block->fd_array[fd].position, &temp_dentry);
+
+		name_len = fname_length(temp_dentry.f_name);
+		if(name_len > FNAMESIZE)
+			name_len = FNAMESIZE;
+
+		/* header, name and terminator, rounded up to keep records 4 byte aligned */
+		rec_len = (sizeof(dirent_t) + name_len + 1 + 3) & ~3;
+		if(ret_bytes + rec_len > nbytes)
+			break;
+
+		record->f_type = temp_dentry.f_type;
+		record->name_len = name_len;
+		record->rec_len = rec_len;
+		if(temp_dentry.f_type == REGULAR_FILE && temp_dentry.inode_num < n_inodes){
+
+			record->inode_num = temp_dentry.inode_num;
+			record->size = fs_inodes[temp_dentry.inode_num].length;
+		}
+		else{
+
+			record->inode_num = 0;
+			record->size = 0;
+		}
+		memcpy((void*)record->name, (void*)temp_dentry.f_name, name_len);
+		record->name[name_len] = '\0';
+
+		/* the padding is left as it was*/
+		if(copy_to_user(buf + ret_bytes, record, sizeof(dirent_t) + name_len + 1) == -1)
+			return -1;
+
+		ret_bytes += rec_len;
+		control_block->fd_array[fd].position++;
+	}
+
+	/* the next record did not fit at all */
+	if(ret_bytes == 0 && control_block->fd_array[fd].position < n_dentries + VIRTUAL_DENTRIES)
+		return -1;
+
+	return ret_bytes;
 }
 
 /*
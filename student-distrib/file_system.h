@@ -8,6 +8,16 @@
 #include "types.h"
 #include "multiboot.h"
 
+/* whence values for lseek */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+
+/* file type of the kernel generated files that follow the image's dentries */
+#define STATS_FILE 3
+
+#define FNAMESIZE 32 // longest file name, it has no '\0' at this length
+
 
 
 typedef struct{
@@ -35,18 +45,83 @@ typedef struct{
 	uint8_t reserved[52];
 } system_stats;
 
+/* A run of physically contiguous data blocks belonging to one file */
+typedef struct{
+
+	uint32_t file_block; // index of the run's first block within the file
+	uint32_t first_block; // data block number the run starts at
+	uint32_t num_blocks; // number of contiguous data blocks in the run
+} extent_t;
+
+/* Where an inode's runs live in the extent pool built by fs_init */
+typedef struct{
+
+	uint32_t first_extent; // index of the inode's first run in the pool
+	uint32_t num_extents; // number of runs the file is made of
+	uint32_t mapped; // 1 if the runs were built, 0 if the pool ran out
+	uint32_t bad; // 1 if the inode names a data block outside the image
+} inode_extent_map;
+
+/* What sys_execute needs to know about a program, cached per inode */
+typedef struct{
+
+	uint32_t valid; // 1 once the entry has been filled and its header checked
+	dentry_t dentry; // directory entry the program was found through
+	uint32_t length; // size of the image in bytes
+	uint32_t entry_point; // address of the first instruction, from the header
+} exec_info_t;
+
+/* One record of a batched directory read. Records are packed back to back,
+   rec_len bytes apart, each name is followed by a '\0' */
+typedef struct{
+
+	uint32_t inode_num; // inode of the file, 0 for rtc and directories
+	uint32_t size; // length of the file in bytes, 0 for rtc and directories
+	uint16_t rec_len; // size of the record including the name and padding
+	uint8_t f_type; // 0 rtc, 1 directory, 2 regular file
+	uint8_t name_len; // length of the name without the '\0'
+	uint8_t name[]; // the name
+} dirent_t;
+
+/* One slot of the open-addressed name index built by fs_init */
+typedef struct{
+
+	uint8_t in_use; // slot holds a dentry
+	uint8_t name_len; // precomputed length of the dentry's name
+	uint16_t dentry_idx; // index into the boot block's dentry array
+} dentry_hash_slot;
+
 
 inode* fs_inodes;
+
+/* Name lookup statistics, updated by read_dentry_by_name */
+extern uint32_t fs_lookups; // number of lookups performed
+extern uint32_t fs_lookup_compares; // total name comparisons over all lookups
+extern uint32_t fs_last_lookup_compares; // name comparisons done by the most recent lookup
+
+/* Executable cache statistics, updated by fs_exec_lookup */
+extern uint32_t exec_cache_hits;
+extern uint32_t exec_cache_misses;
 	
 
 
 extern void fs_init(module_t module);
 
-extern int32_t fs_load(const uint8_t* fname, uint32_t address);
+extern int32_t fs_exec_lookup(const uint8_t* fname, exec_info_t* exe);
+
+extern int32_t fs_page_block(uint32_t inode, uint32_t offset, uint32_t* block_addr);
+
+extern int32_t fs_file_length(uint32_t inode);
+
+extern int32_t fs_data_run(uint32_t inode, uint32_t offset, uint8_t** data);
+
+/* Compressed image statistics, updated by fs_block */
+extern uint32_t fs_compressed;
+extern uint32_t fs_cache_hits;
+extern uint32_t fs_cache_misses;
 
 extern int32_t fs_open(module_t module);
 
-extern int32_t fs_read(const uint8_t* fname, uint8_t * buf, uint32_t offset, uint32_t nbytes);
 
 
 
@@ -59,6 +134,10 @@ extern int32_t read_data(uint32_t inode, uint32_t offset, uint8_t* buf, uint32_t
 extern int32_t file_open(const uint8_t* filename);
 extern int32_t file_read(int32_t fd, uint8_t* buf, int32_t nbytes);
 
+extern int32_t file_pread(int32_t fd, uint8_t* buf, int32_t nbytes, uint32_t offset);
+
+extern int32_t file_lseek(int32_t fd, int32_t offset, int32_t whence);
+
 
 
 extern int32_t file_write(int32_t fd, const void* buf, int32_t nbytes);
@@ -70,6 +149,8 @@ extern int32_t dir_open( const uint8_t* filename);
 
 extern int32_t dir_read(int32_t fd, uint8_t * buf, int32_t nbytes);
 
+extern int32_t dir_getdents(int32_t fd, uint8_t * buf, int32_t nbytes);
+
 
 
 extern int32_t dir_write(int32_t fd, const void* buf, int32_t nbytes);
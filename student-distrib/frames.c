@@ -0,0 +1,181 @@
+/* frames.c - allocator for the 4kB physical frames above the kernel. Page tables,
+ * kernel stacks and every page of a program come from here, so memory is only
+ * used for what processes actually touch. A frame is counted for each process
+ * that maps it, so fork can share pages until one of them writes
+ * vim:ts=4 noexpandtab
+ */
+
+#include "frames.h"
+#include "lib.h"
+
+#define MB1 0x00100000 /* mem_upper counts from here */
+#define KB1 0x400
+
+static uint16_t frame_refs[MAX_FRAMES];	/* users of the frame, 0 if it is free */
+static uint32_t num_frames = 0;			/* frames that exist */
+static uint32_t free_frames = 0;
+static uint32_t next_frame = 0;			/* where the search for a single frame starts */
+
+/* frames_init
+ * DESCRIPTION: sets up the allocator for the memory between FRAMES_START and the end
+ *				of memory, or FRAMES_LIMIT if that comes first
+ * INPUTS: mem_upper - KB of memory above 1MB, 0 if the boot loader did not say
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: every frame is free
+ */
+void frames_init(uint32_t mem_upper){
+
+	uint32_t end;
+
+	end = (mem_upper != 0) ? MB1 + mem_upper * KB1 : FRAMES_DEFAULT_END;
+	if(mem_upper > (FRAMES_LIMIT - MB1) / KB1)
+		end = FRAMES_LIMIT;
+
+	num_frames = (end > FRAMES_START) ? (end - FRAMES_START) / FRAME_SIZE : 0;
+	free_frames = num_frames;
+	next_frame = 0;
+	memset(frame_refs, 0, sizeof(frame_refs));
+}
+
+/* frames_alloc
+ * DESCRIPTION: finds count free frames in a row. A single frame is searched for from
+ *				just after the last one handed out, a longer run from the start
+ * INPUTS: count - number of frames
+ * OUTPUTS: none
+ * RETURN VALUE: physical address of the first frame, 0 if there is no such run
+ * SIDE EFFECTS: each frame has one user
+ */
+uint32_t frames_alloc(uint32_t count){
+
+	uint32_t first;
+	uint32_t run;
+	uint32_t n;
+	uint32_t i;
+
+	if(count == 0 || count > free_frames)
+		return 0;
+
+	first = (count == 1) ? next_frame : 0;
+	run = 0;
+	for(n = 0; n < num_frames; n++){
+
+		i = (first + n) % num_frames;
+		if(i == 0)
+			run = 0;	/* runs do not wrap around */
+
+		if(frame_refs[i]){
+			run = 0;
+			continue;
+		}
+
+		if(++run < count)
+			continue;
+
+		first = i + 1 - count;
+		for(i = first; i < first + count; i++)
+			frame_refs[i] = 1;
+		free_frames -= count;
+		next_frame = i % num_frames;
+		return FRAMES_START + first * FRAME_SIZE;
+	}
+
+	return 0;
+}
+
+/* frames_free
+ * DESCRIPTION: drops a user of frames from frames_alloc, a frame with no users
+ *				left is free again
+ * INPUTS: addr - physical address of the first frame
+ *		   count - number of frames
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void frames_free(uint32_t addr, uint32_t count){
+
+	uint32_t i;
+
+	if(addr < FRAMES_START)
+		return;
+
+	for(i = (addr - FRAMES_START) / FRAME_SIZE; count > 0 && i < num_frames; i++, count--){
+
+		if(frame_refs[i] && --frame_refs[i] == 0)
+			free_frames++;
+	}
+}
+
+/* frames_share
+ * DESCRIPTION: adds a user to an allocated frame, for a page mapped by a second process
+ * INPUTS: addr - physical address of the frame
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: the frame is not freed until frames_free is called once more
+ */
+void frames_share(uint32_t addr){
+
+	uint32_t i;
+
+	i = (addr - FRAMES_START) / FRAME_SIZE;
+	if(addr >= FRAMES_START && i < num_frames && frame_refs[i])
+		frame_refs[i]++;
+}
+
+/* frames_users
+ * DESCRIPTION: counts the processes mapping a frame
+ * INPUTS: addr - physical address of the frame
+ * OUTPUTS: none
+ * RETURN VALUE: number of users, 0 if the frame is free or not one of ours
+ * SIDE EFFECTS: none
+ */
+uint32_t frames_users(uint32_t addr){
+
+	uint32_t i;
+
+	i = (addr - FRAMES_START) / FRAME_SIZE;
+	if(addr < FRAMES_START || i >= num_frames)
+		return 0;
+	return frame_refs[i];
+}
+
+/* frames_realloc
+ * DESCRIPTION: moves a table that lives in frames into a run big enough for new_bytes.
+ *				Used by tables that grow with the number of processes
+ * INPUTS: old - the table, NULL if there is none yet
+ *		   old_bytes - its size
+ *		   new_bytes - size it needs, at least old_bytes
+ * OUTPUTS: none
+ * RETURN VALUE: the new table, with the old contents and zeros after them, NULL if
+ *				 there is no memory, in which case old is left alone
+ * SIDE EFFECTS: old is freed
+ */
+void* frames_realloc(void* old, uint32_t old_bytes, uint32_t new_bytes){
+
+	uint32_t table;
+
+	table = frames_alloc((new_bytes + FRAME_SIZE - 1) / FRAME_SIZE);
+	if(table == 0)
+		return NULL;
+
+	if(old != NULL)
+		memcpy((void*)table, old, old_bytes);
+	memset((void*)(table + old_bytes), 0, new_bytes - old_bytes);
+
+	if(old != NULL)
+		frames_free((uint32_t)old, (old_bytes + FRAME_SIZE - 1) / FRAME_SIZE);
+
+	return (void*)table;
+}
+
+/* frames_available
+ * DESCRIPTION: counts the free frames
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: number of frames that are free
+ * SIDE EFFECTS: none
+ */
+uint32_t frames_available(void){
+
+	return free_frames;
+}
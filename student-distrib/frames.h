@@ -0,0 +1,37 @@
+/* frames.h - allocator for the 4kB physical frames above the kernel
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _FRAMES_H
+#define _FRAMES_H
+
+#include "types.h"
+
+#define FRAME_SIZE 0x1000
+#define FRAMES_START 0x00800000	/* first frame, just above the kernel's 4MB page */
+#define FRAMES_LIMIT 0x08000000	/* frames end here at most, where the program page starts, so
+								   init_paging can map them all one to one for the kernel */
+#define MAX_FRAMES ((FRAMES_LIMIT - FRAMES_START) / FRAME_SIZE)
+#define FRAMES_DEFAULT_END 0x02000000	/* used if the boot loader gives no memory size */
+
+/* Externally-visible functions */
+
+/* Learns how much memory there is, mem_upper as the boot loader reports it */
+void frames_init(uint32_t mem_upper);
+
+/* Allocates count contiguous frames, returns the physical address or 0. The frames
+   are not cleared, and the kernel reaches them at the same virtual address */
+uint32_t frames_alloc(uint32_t count);
+void frames_free(uint32_t addr, uint32_t count);
+
+/* Counts another process mapping a frame, frames_free then drops one user */
+void frames_share(uint32_t addr);
+uint32_t frames_users(uint32_t addr);
+
+/* Moves a table into new frames big enough for new_bytes, keeping old_bytes of it */
+void* frames_realloc(void* old, uint32_t old_bytes, uint32_t new_bytes);
+
+/* Frames that are free now */
+uint32_t frames_available(void);
+
+#endif /* _FRAMES_H */
@@ -11,14 +11,14 @@
  * INPUTS: name, str
  * OUTPUTS: prints exception
  * RETURN VALUE: none
- * SIDE EFFECTS: halts function which faulted
+ * SIDE EFFECTS: halts function which faulted, its parent sees HALT_EXCEPTION
  */
 #define DO_ERROR(name, str);			\
 void DO_##name() 						\
 {										\
 	asm("cli");							\
 	printf("%s exception\n", #str);		\
-	sys_halt(0);						\
+	halt_process(HALT_EXCEPTION);		\
 }										\
 
 DO_ERROR(ZERO_DIVIDE, "Divide by Zero");
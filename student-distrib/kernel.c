@@ -14,6 +14,8 @@
 #include "file_system.h"
 #include "system_calls.h"
 #include "scheduling.h"
+#include "syscall_linkage.h"
+#include "frames.h"
 
 
 /* Macros. */
@@ -167,6 +169,7 @@ entry (unsigned long magic, unsigned long addr)
 	/* init the IDT */
 	init_idt_array();
 	lidt(idt_desc_ptr);
+	sysenter_init();
 
 	/* Init the PIC */
 	i8259_init();
@@ -194,9 +197,11 @@ entry (unsigned long magic, unsigned long addr)
 	
  
  	init_paging();
+ 	frames_init(CHECK_FLAG(mbi->flags, 0) ? mbi->mem_upper : 0);
 
  	set_terminal_memory();
  	pit_init();
+ 	idle_init();
  
 
  
@@ -219,11 +224,8 @@ entry (unsigned long magic, unsigned long addr)
 	//sys_execute((uint8_t*)"shell");
 	boot();
 
-	while (1)
-	{
-	}
-
-	/* Spin (nicely, so we don't chew up cycles) */
+	/* boot() does not return, the idle task has the processor when no process
+	   can run. Should it ever return, spin nicely */
 	asm volatile(".1: hlt; jmp .1;");
 }
 
@@ -77,6 +77,9 @@ void keyboard_init (void)
 	terminals[0].allow_read = 0;
 	terminals[1].allow_read = 0;
 	terminals[2].allow_read = 0;
+	terminals[0].read_wait.boost = 1;
+	terminals[1].read_wait.boost = 1;
+	terminals[2].read_wait.boost = 1;
 	//cursor_y = 0;
 	enable_irq(1);		//Enabling keyboard interrupts
 	asm("sti");
@@ -145,7 +148,7 @@ void keyboard_interrupt_handler (void)
 					terminals[1].shell_exists = 1;
 					send_eoi(1);
 					sti();
-					sys_execute((uint8_t*)"shell terminal");
+					kernel_execute((uint8_t*)"shell terminal");
 				}
 				goto key_end;
 					
@@ -161,7 +164,7 @@ void keyboard_interrupt_handler (void)
 					terminals[2].shell_exists = 1;
 					send_eoi(1);
 					sti();
-					sys_execute((uint8_t*)"shell terminal");
+					kernel_execute((uint8_t*)"shell terminal");
 					
 				}
 				goto key_end;
@@ -224,6 +227,8 @@ void keyboard_interrupt_handler (void)
 		terminals[get_active_terminal()].keyboard_buffer[terminals[get_active_terminal()].buf_idx] = '\0';
 		memcpy((void*)read_buffer,(void*) terminals[get_active_terminal()].keyboard_buffer, 1024);
 		terminals[get_active_terminal()].allow_read = 1;
+		kernel_data->enter_tsc = rdtsc();
+		wake_up(&terminals[get_active_terminal()].read_wait);
 
 		clear_buffer();
 		keyboard_write(0, (void *)&keyPressed, 1);
@@ -10,6 +10,12 @@
 
 static char* video_mem = (char *)VIDEO;
 
+/* user_copy.S */
+extern int32_t user_memcpy(void* dest, const void* src, uint32_t n);
+extern int32_t user_strncpy(int8_t* dest, const int8_t* src, uint32_t n);
+extern uint32_t ex_table[];
+extern uint32_t ex_table_end[];
+
 
 terminal_t terminals[3];	//The three terminals
 
@@ -651,6 +657,107 @@ strncpy(int8_t* dest, const int8_t* src, uint32_t n)
 	return dest;
 }
 
+/*
+* int32_t bad_userspace_addr(const void* addr, int32_t len);
+*   Inputs: const void* addr = start of a user buffer
+*			int32_t len = size of the buffer
+*   Return Value: 0 if the buffer lies wholly in the program page, 1 otherwise
+*	Function: the range check every copy to or from user memory makes
+*/
+
+int32_t
+bad_userspace_addr(const void* addr, int32_t len)
+{
+	uint32_t start = (uint32_t)addr;
+
+	if(len < 0 || start < USER_MEM_START || start > USER_MEM_END)
+		return 1;
+
+	return (uint32_t)len > USER_MEM_END - start;
+}
+
+/*
+* int32_t copy_to_user(void* to, const void* from, int32_t n);
+*   Inputs: void* to = user buffer
+*			const void* from = kernel source
+*			int32_t n = number of bytes to copy
+*   Return Value: 0 on success, -1 if to is not in the program page or a page
+*					of it could not be mapped, in which case part may be written
+*	Function: copy n bytes out to a program
+*/
+
+int32_t
+copy_to_user(void* to, const void* from, int32_t n)
+{
+	if(bad_userspace_addr(to, n))
+		return -1;
+
+	return user_memcpy(to, from, n);
+}
+
+/*
+* int32_t copy_from_user(void* to, const void* from, int32_t n);
+*   Inputs: void* to = kernel buffer
+*			const void* from = user source
+*			int32_t n = number of bytes to copy
+*   Return Value: 0 on success, -1 if from is not in the program page or a page
+*					of it could not be mapped
+*	Function: copy n bytes in from a program
+*/
+
+int32_t
+copy_from_user(void* to, const void* from, int32_t n)
+{
+	if(bad_userspace_addr(from, n))
+		return -1;
+
+	return user_memcpy(to, from, n);
+}
+
+/*
+* int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
+*   Inputs: int8_t* dest = kernel buffer of n bytes
+*			const int8_t* src = user string
+*			int32_t n = most bytes to copy, terminator included
+*   Return Value: length of the string, -1 if it does not fit in n bytes, runs
+*					out of the program page or a page of it could not be mapped
+*	Function: copy a string in from a program
+*/
+
+int32_t
+safe_strncpy(int8_t* dest, const int8_t* src, int32_t n)
+{
+	if(n <= 0 || bad_userspace_addr(src, 1))
+		return -1;
+
+	/* the string may end anywhere in the program page, but not past it */
+	if((uint32_t)n > USER_MEM_END - (uint32_t)src)
+		n = USER_MEM_END - (uint32_t)src;
+
+	return user_strncpy(dest, src, n);
+}
+
+/*
+* uint32_t search_ex_table(uint32_t eip);
+*   Inputs: uint32_t eip = address of an instruction that page faulted
+*   Return Value: where to resume if it was a copy to or from user memory, 0 if
+*					the fault is fatal
+*	Function: looks eip up in the fixup table of user_copy.S
+*/
+
+uint32_t
+search_ex_table(uint32_t eip)
+{
+	uint32_t* entry;
+
+	for(entry = ex_table; entry < ex_table_end; entry += 2) {
+		if(entry[0] == eip)
+			return entry[1];
+	}
+
+	return 0;
+}
+
 /*
 * void test_interrupts(void)
 *   Inputs: void
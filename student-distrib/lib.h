@@ -22,6 +22,10 @@
 #define VIDEO3 0x09005000
 #define VIDEO3_PHYS 0x00005000
 #define VIDEO3_IDX (0x05000 / KB_ALIGN)
+#define KERNEL_DATA 0x09007000
+#define KERNEL_DATA_IDX (0x07000 / KB_ALIGN)
+#define USER_MEM_START 0x08000000 /* the program page, all a system call may read or write */
+#define USER_MEM_END 0x08400000
 #define SHELL_DOES_EXIST 1
 #define SHELL_DOESNT_EXIST 0
 
@@ -49,6 +53,9 @@ extern void test_interrupts(void);
 /* Userspace address-check functions */
 int32_t bad_userspace_addr(const void* addr, int32_t len);
 int32_t safe_strncpy(int8_t* dest, const int8_t* src, int32_t n);
+int32_t copy_to_user(void* to, const void* from, int32_t n);
+int32_t copy_from_user(void* to, const void* from, int32_t n);
+uint32_t search_ex_table(uint32_t eip);
 
 /* Port read functions */
 /* Inb reads a byte and returns its value as a zero-extended 32-bit
@@ -164,4 +171,27 @@ do {                                    \
 			);                      \
 } while(0)
 
+/* Reads the low 32 bits of the time stamp counter. Differences of two
+ * reads are good for intervals of up to about a second */
+static inline uint32_t rdtsc(void)
+{
+	uint32_t low;
+	uint32_t high;
+	asm volatile("rdtsc"
+			: "=a"(low), "=d"(high)
+			);
+	return low;
+}
+
+/* Reads the whole time stamp counter, for intervals that may be longer
+ * than a second */
+static inline uint64_t rdtsc64(void)
+{
+	uint64_t tsc;
+	asm volatile("rdtsc"
+			: "=A"(tsc)
+			);
+	return tsc;
+}
+
 #endif /* _LIB_H */
@@ -3,11 +3,30 @@
  */
 #include "paging.h"
 #include "lib.h"
+#include "system_calls.h"
+#include "frames.h"
 
 unsigned int page_table[MAX_ENTRIES] __attribute__((aligned(KB_ALIGN)));
 unsigned int video_table[MAX_ENTRIES] __attribute__((aligned(KB_ALIGN)));
 unsigned int page_directory[MAX_ENTRIES] __attribute__((aligned(KB_ALIGN)));
 
+/* padded to a page so nothing else in the kernel is visible through the mapping */
+static union{
+	kernel_data_t fields;
+	unsigned int page[MAX_ENTRIES];
+} kernel_data_page __attribute__((aligned(KB_ALIGN)));
+volatile kernel_data_t* const kernel_data = &kernel_data_page.fields;
+
+uint32_t demand_page_faults = 0;	/* pages filled by do_page_fault */
+uint32_t shared_page_maps = 0;		/* image pages mapped straight from the file system */
+uint32_t cow_page_copies = 0;		/* shared pages copied because they were written */
+uint32_t fork_page_shares = 0;		/* private pages shared with a forked child */
+uint32_t file_page_maps = 0;		/* mmap pages mapped straight from the file system */
+
+static int32_t map_program_page(const exec_info_t* exe, uint32_t page_addr, uint32_t write);
+static unsigned int* current_program_table(void);
+static unsigned int program_entry(int i);
+
 /* init_paging
  * DESCRIPTION: sets up the page table, page directory, and video memory pages
  * INPUTS: none
@@ -34,6 +53,9 @@ void init_paging()
 	    video_table[VIDEO2_IDX] = SET_VID | VIDEO2_PHYS;
 	    video_table[VIDEO3_IDX] = SET_VID | VIDEO3_PHYS;
 
+	    /* user can read it but not write it */
+	    video_table[KERNEL_DATA_IDX] = SET_PRESENT | SET_USER_SUPERVISOR | (unsigned int)&kernel_data_page;
+
 	    temp = (int)page_table;
 
 	    page_directory[0] = SET_PRESENT | SET_READ_WRITE | SET_USER_SUPERVISOR;
@@ -44,6 +66,10 @@ void init_paging()
 
 	    page_directory[VIDEO_DIRECTORY_IDX] = ((int)video_table & 0xFFFFF000) | SET_USER_SUPERVISOR | SET_READ_WRITE | SET_PRESENT;
 
+	    /* the kernel reaches every frame of frames.c at its physical address */
+	    for(i = FRAMES_START >> MB4OFFSET; i < FRAMES_LIMIT >> MB4OFFSET; i++)
+	    	page_directory[i] = (i << MB4OFFSET) | SET_GLOBAL | SET_SIZE | SET_PRESENT | SET_READ_WRITE;
+
 	    page_dir_addr = (unsigned int*)page_directory;
 
 	    set_registers(page_dir_addr);
@@ -55,14 +81,14 @@ void init_paging()
  * INPUTS: p_num - process number to be set
  * OUTPUTS: none
  * RETURN VALUE: none
- * SIDE EFFECTS: changes page_directory entry to hold the new process's page
+ * SIDE EFFECTS: changes page_directory entry to hold the new process's page table
  */
 void page_allocator(int32_t p_num){
 
 		unsigned int* page_dir_addr;  
 
 	    page_directory[PROGRAM_IDX] = 0x00000000;
-	    page_directory[PROGRAM_IDX] = page_directory[PROGRAM_IDX] | SET_SIZE | SET_PRESENT | SET_USER_SUPERVISOR| SET_READ_WRITE | (p_num + 2) << MB4OFFSET;
+	    page_directory[PROGRAM_IDX] = page_directory[PROGRAM_IDX] | SET_PRESENT | SET_USER_SUPERVISOR| SET_READ_WRITE | ((unsigned int)get_process_pcb(p_num)->page_table & 0xFFFFF000);
 
 	    //page_helper(page_directory);
 
@@ -72,6 +98,304 @@ void page_allocator(int32_t p_num){
 }
 
 
+/* program_entry
+ * DESCRIPTION: gives the entry a page of the program page starts out with. The mmap
+ *				window is left out of the memory filled on first touch, so a page
+ *				there never holds a frame of its own before mmap maps it
+ * INPUTS: i - index of the page in the program page table
+ * OUTPUTS: none
+ * RETURN VALUE: PROGRAM_LAZY, or 0 for a page of the mmap window
+ * SIDE EFFECTS: none
+ */
+static unsigned int program_entry(int i){
+
+	if(i >= ((MMAP_START - _128MB) >> KB4OFFSET) && i < ((MMAP_END - _128MB) >> KB4OFFSET))
+		return 0;
+	return PROGRAM_LAZY;
+}
+
+/* program_map_init
+ * DESCRIPTION: sets up a new process's page table for the 128MB program page. Every 4kB
+ *				page is left not present, and outside the mmap window gets a frame only
+ *				when it is first touched
+ * INPUTS: p_num - process number whose table is set up
+ * OUTPUTS: the process's page table is rewritten
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void program_map_init(int32_t p_num){
+
+	unsigned int* table;
+	int i;
+
+	table = get_process_pcb(p_num)->page_table;
+	for(i = 0; i < MAX_ENTRIES; i++)
+		table[i] = program_entry(i);
+}
+
+/* program_map_free
+ * DESCRIPTION: gives back every frame a process's program page took, including the
+ *				copied pages of its mmaps, and leaves the page as program_map_init did
+ * INPUTS: p_num - process number
+ * OUTPUTS: the process's page table is rewritten
+ * RETURN VALUE: none
+ * SIDE EFFECTS: TLB must be flushed (page_allocator) before the process runs again
+ */
+void program_map_free(int32_t p_num){
+
+	unsigned int* table;
+	int i;
+
+	table = get_process_pcb(p_num)->page_table;
+	for(i = 0; i < MAX_ENTRIES; i++){
+
+		if((table[i] & SET_PRESENT) && (table[i] & SET_FRAME))
+			frames_free(table[i] & ~(KB_ALIGN - 1), 1);
+		table[i] = program_entry(i);
+	}
+}
+
+/* program_map_fork
+ * DESCRIPTION: gives a forked child the parent's program page without copying it. Every
+ *				frame the parent owns is shared, and the writable ones become read
+ *				only copy on write pages in both processes, so whichever writes
+ *				first gets its own copy
+ * INPUTS: parent - process being forked, whose page is mapped now
+ *		   child - new process, its table set up by program_map_init
+ * OUTPUTS: both page tables are rewritten
+ * RETURN VALUE: none
+ * SIDE EFFECTS: flushes the TLB
+ */
+void program_map_fork(int32_t parent, int32_t child){
+
+	unsigned int* from;
+	unsigned int* to;
+	int i;
+
+	from = get_process_pcb(parent)->page_table;
+	to = get_process_pcb(child)->page_table;
+	for(i = 0; i < MAX_ENTRIES; i++){
+
+		if((from[i] & SET_PRESENT) && (from[i] & SET_FRAME)){
+
+			if(from[i] & SET_READ_WRITE)
+				from[i] = (from[i] & ~SET_READ_WRITE) | SET_COW;
+			frames_share(from[i] & ~(KB_ALIGN - 1));
+			fork_page_shares++;
+		}
+		to[i] = from[i];
+	}
+
+	page_allocator(parent);
+}
+
+/* program_map_file
+ * DESCRIPTION: maps a file read only into the executing process's program page. Whole
+ *				pages point straight at the file's data blocks, the partial last page
+ *				(or any page whose block cannot be mapped) is copied into the page's
+ *				private frame and zero filled
+ * INPUTS: inode - file to map
+ *		   length - size of the file in bytes
+ *		   start - page aligned virtual address to map it at
+ * OUTPUTS: writes the page table entries and any copied pages
+ * RETURN VALUE: 0 on success, -1 if memory ran out, with part of the file mapped
+ * SIDE EFFECTS: program page must already be mapped with page_allocator, a frame the
+ *				 page already held is given back
+ */
+int32_t program_map_file(uint32_t inode, uint32_t length, uint32_t start){
+
+	unsigned int* entry;
+	uint32_t offset;
+	uint32_t page_addr;
+	uint32_t block_addr;
+	uint32_t frame;
+	int32_t copied;
+
+	for(offset = 0; offset < length; offset += KB_ALIGN){
+
+		page_addr = start + offset;
+		entry = &current_program_table()[(page_addr - _128MB) >> KB4OFFSET];
+		if((*entry & SET_PRESENT) && (*entry & SET_FRAME)){
+
+			frames_free(*entry & ~(KB_ALIGN - 1), 1);
+			*entry = 0;
+		}
+
+		if(fs_page_block(inode, offset, &block_addr) == 0){
+
+			*entry = block_addr | SET_PRESENT | SET_USER_SUPERVISOR;
+			asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+			file_page_maps++;
+			continue;
+		}
+
+		// fill a private frame, then take away write access
+		frame = frames_alloc(1);
+		if(frame == 0)
+			return -1;
+		*entry = frame | SET_PRESENT | SET_USER_SUPERVISOR | SET_READ_WRITE | SET_FRAME;
+		asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+
+		copied = read_data(inode, offset, (uint8_t*)page_addr, KB_ALIGN);
+		if(copied < 0)
+			copied = 0;
+		memset((void*)(page_addr + copied), 0, KB_ALIGN - copied);
+
+		*entry &= ~SET_READ_WRITE;
+		asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+	}
+
+	return 0;
+}
+
+/* program_load
+ * DESCRIPTION: maps every page of a program image into the executing process up front.
+ *				Whole pages are shared straight from the file's data blocks when
+ *				possible, the rest are copied. A page there is no frame for is left
+ *				to the page fault handler
+ * INPUTS: exe - program being started
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: program page must already be mapped with page_allocator
+ */
+void program_load(const exec_info_t* exe){
+
+	uint32_t page_addr;
+
+	for(page_addr = IMAGE_MEM; page_addr < IMAGE_MEM + exe->length; page_addr += KB_ALIGN)
+		map_program_page(exe, page_addr, 0);
+}
+
+/* do_page_fault
+ * DESCRIPTION: handles a page fault. A not present page of the program page that was
+ *				left for demand paging is mapped and filled, a write to a shared page
+ *				of the image or of a forked process gets a private copy, or is made
+ *				writable again if no other process maps it. Anything else is fatal
+ * INPUTS: address - faulting linear address (CR2)
+ *		   error_code - error code pushed by the processor
+ * OUTPUTS: none
+ * RETURN VALUE: 0 if the fault was handled and the access can be retried, -1 otherwise
+ * SIDE EFFECTS: maps a page of the executing process's program page
+ */
+int32_t do_page_fault(uint32_t address, uint32_t error_code){
+
+	unsigned int* entry;
+	uint32_t page_addr;
+	uint32_t shared_addr;
+	uint32_t frame;
+	PCB_struct* control_block;
+
+	if(address < _128MB || address >= _132MB)
+		return -1;
+
+	page_addr = address & ~(KB_ALIGN - 1);
+	entry = &current_program_table()[(page_addr - _128MB) >> KB4OFFSET];
+	control_block = get_process_pcb(executing_process);
+
+	if(!(*entry & SET_PRESENT)){
+
+		if(!(*entry & SET_LAZY))
+			return -1;
+
+		if(map_program_page(&control_block->exe, page_addr, error_code & PF_WRITE) == -1)
+			return -1;
+		demand_page_faults++;
+		return 0;
+	}
+
+	/* copy on write of a page shared with the file system or another process */
+	if((error_code & PF_WRITE) && (*entry & SET_COW)){
+
+		shared_addr = *entry & ~(KB_ALIGN - 1);
+
+		// the other processes have let go of it, this one can have it
+		if((*entry & SET_FRAME) && frames_users(shared_addr) == 1){
+
+			*entry = (*entry & ~SET_COW) | SET_READ_WRITE;
+			asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+			return 0;
+		}
+
+		frame = frames_alloc(1);
+		if(frame == 0)
+			return -1;
+
+		memcpy((void*)frame, (void*)shared_addr, KB_ALIGN);
+		if(*entry & SET_FRAME)
+			frames_free(shared_addr, 1);
+
+		*entry = frame | SET_PRESENT | SET_USER_SUPERVISOR | SET_READ_WRITE | SET_FRAME;
+		asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+		cow_page_copies++;
+		return 0;
+	}
+
+	return -1;
+}
+
+/* map_program_page
+ * DESCRIPTION: maps one page of the executing process's program page. A read of a page
+ *				that lies wholly inside the image is mapped read only straight from the
+ *				file's data block, which every process running the program shares.
+ *				Otherwise the page gets a private frame, filled from the image where
+ *				it overlaps it and zeroed elsewhere (bss, heap, stack)
+ * INPUTS: exe - program image of the executing process
+ *		   page_addr - virtual address of the page
+ *		   write - nonzero if the page is about to be written
+ * OUTPUTS: writes the page table entry and the page
+ * RETURN VALUE: 0 on success, -1 if there is no free frame
+ * SIDE EFFECTS: none
+ */
+static int32_t map_program_page(const exec_info_t* exe, uint32_t page_addr, uint32_t write){
+
+	unsigned int* entry;
+	uint32_t block_addr;
+	uint32_t frame;
+	int32_t copied;
+
+	entry = &current_program_table()[(page_addr - _128MB) >> KB4OFFSET];
+
+	if(!write && page_addr >= IMAGE_MEM &&
+		fs_page_block(exe->dentry.inode_num, page_addr - IMAGE_MEM, &block_addr) == 0){
+
+		*entry = block_addr | SET_PRESENT | SET_USER_SUPERVISOR | SET_COW;
+		asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+		shared_page_maps++;
+		return 0;
+	}
+
+	frame = frames_alloc(1);
+	if(frame == 0)
+		return -1;
+
+	*entry = frame | SET_PRESENT | SET_USER_SUPERVISOR | SET_READ_WRITE | SET_FRAME;
+	asm volatile("invlpg (%0)" :: "r"(page_addr) : "memory");
+
+	copied = 0;
+	if(page_addr >= IMAGE_MEM){
+
+		copied = read_data(exe->dentry.inode_num, page_addr - IMAGE_MEM, (uint8_t*)page_addr, KB_ALIGN);
+		if(copied < 0)
+			copied = 0;
+	}
+
+	memset((void*)(page_addr + copied), 0, KB_ALIGN - copied);
+	return 0;
+}
+
+/* current_program_table
+ * DESCRIPTION: finds the page table page_allocator last put in for the program page.
+ *				Frames are mapped one to one, so its physical address can be used
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: the page table
+ * SIDE EFFECTS: none
+ */
+static unsigned int* current_program_table(void){
+
+	return (unsigned int*)(page_directory[PROGRAM_IDX] & ~(KB_ALIGN - 1));
+}
+
 /* page_vid_map
  * DESCRIPTION: maps the given terminal's video page to be the active video memory
  * INPUTS: terminal - 0, 1, or 2 depending on which terminal is now active
@@ -12,6 +12,7 @@
 #include "debug.h"
 #include "types.h"
 #include "paging_help.h"
+#include "file_system.h"
 
 
 #define VIDEO 0xB8000
@@ -31,10 +32,35 @@
 #define SET_SIZE 0x00000080
 #define SET_USER_SUPERVISOR 0x00000004
 #define SET_GLOBAL 0x00000100
+#define SET_LAZY 0x00000200 /* available bit, page is filled on first touch */
+#define SET_COW 0x00000400 /* available bit, read only page shared with the file system or a forked process */
+#define SET_FRAME 0x00000800 /* available bit, the frame came from frames_alloc for this process */
+#define PROGRAM_LAZY (SET_LAZY | SET_USER_SUPERVISOR | SET_READ_WRITE) /* program page entry with no frame yet */
+
+#define PF_WRITE 0x00000002 /* page fault error code bit for a write access */
 #define SET_VID (SET_PRESENT | SET_READ_WRITE | SET_USER_SUPERVISOR)
 
 #define VIDEO_IDX (VIDEO / 0x1000)
 
+#define MMAP_START 0x08200000 /* part of the program page handed out to mmap, not lazy memory */
+#define MMAP_END 0x08300000
+
+/* Read only page every process sees at KERNEL_DATA, so it can read the time
+   without a system call. The kernel updates it from its interrupt handlers */
+typedef struct kernel_data_t{
+	uint32_t pit_ticks; // PIT periods since boot, counted from the time stamp counter when tickless
+	uint32_t rtc_ticks; // RTC interrupts since boot
+	uint32_t pit_hz; // PIT interrupts per second
+	uint32_t tsc_khz; // time stamp counter ticks per millisecond, 0 if unknown
+	uint32_t pid; // process number of the running process
+	uint32_t idle_ms; // time the idle task has spent halted, 0 if tsc_khz is unknown
+	uint32_t timer_irqs; // PIT interrupts taken
+	uint32_t enter_tsc; // time stamp counter when enter was last pressed
+	uint32_t clock_tsc_low; // time stamp counter pit_ticks was last brought up to date at,
+	uint32_t clock_tsc_high; // when tickless
+	uint32_t clock_cycles; // time stamp counter ticks per PIT period when tickless, else 0
+} kernel_data_t;
+
 
 
 
@@ -44,12 +70,32 @@ extern unsigned int page_table[MAX_ENTRIES] __attribute__((aligned(KB_ALIGN)));
 
 extern unsigned int page_directory[MAX_ENTRIES] __attribute__((aligned(KB_ALIGN)));
 
+extern volatile kernel_data_t* const kernel_data;
+
 
 
 extern void init_paging();
 
 extern void page_allocator(int32_t p_num);
 
+extern void program_map_init(int32_t p_num);
+
+extern void program_map_free(int32_t p_num);
+
+extern void program_map_fork(int32_t parent, int32_t child);
+
+extern void program_load(const exec_info_t* exe);
+
+extern int32_t do_page_fault(uint32_t address, uint32_t error_code);
+
+extern int32_t program_map_file(uint32_t inode, uint32_t length, uint32_t start);
+
+extern uint32_t demand_page_faults;
+extern uint32_t shared_page_maps;
+extern uint32_t cow_page_copies;
+extern uint32_t fork_page_shares;
+extern uint32_t file_page_maps;
+
 extern void page_vid_map(int32_t terminal);
 
 void reset_vid_map(int32_t terminal);
@@ -0,0 +1,217 @@
+/* pipe.c - one way byte streams between processes. A reader finding a pipe
+ * empty and a writer finding it full sleep on the pipe until the other side
+ * makes progress or closes its end
+ * vim:ts=4 noexpandtab
+ */
+
+#include "pipe.h"
+#include "lib.h"
+#include "frames.h"
+#include "scheduling.h"
+
+static pipe_t* fd_pipe(int32_t fd);
+
+/* pipe_alloc
+ * DESCRIPTION: makes an empty pipe in a frame of its own
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUE: the pipe, with one reader and one writer, NULL if there is no frame
+ * SIDE EFFECTS: none
+ */
+pipe_t* pipe_alloc(void){
+
+	pipe_t* pipe;
+
+	pipe = (pipe_t*)frames_alloc(1);
+	if(pipe == NULL)
+		return NULL;
+
+	pipe->start = 0;
+	pipe->count = 0;
+	pipe->readers = 1;
+	pipe->writers = 1;
+	pipe->wait.first = NULL;
+	pipe->wait.last = NULL;
+	pipe->wait.boost = 0;
+	return pipe;
+}
+
+/* pipe_share
+ * DESCRIPTION: counts a copy of a pipe fd, made when a process forks or hands its
+ *				fds to a spawned one
+ * INPUTS: file - the new copy
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: the pipe stays open until the copy is closed as well
+ */
+void pipe_share(file_descriptor* file){
+
+	pipe_t* pipe;
+
+	pipe = (pipe_t*)file->inode_ptr;
+	if(file->jtable->read == pipe_read)
+		pipe->readers++;
+	else if(file->jtable->write == pipe_write)
+		pipe->writers++;
+}
+
+/* pipe_read
+ * DESCRIPTION: takes bytes out of a pipe, sleeping until there are some
+ * INPUTS: fd - read end of a pipe
+ *		   buf - user buffer
+ *		   nbytes - most bytes to read
+ * OUTPUTS: fills buf
+ * RETURN VALUE: bytes read, 0 once the pipe is empty and every write end is closed,
+ *				 -1 if buf is bad
+ * SIDE EFFECTS: wakes writers waiting for room
+ */
+int32_t pipe_read(int32_t fd, uint8_t* buf, int32_t nbytes){
+
+	pipe_t* pipe;
+	uint32_t n;
+	uint32_t first;
+
+	cli();
+	pipe = fd_pipe(fd);
+	if(nbytes < 0)
+		return -1;
+	if(nbytes == 0)
+		return 0;
+
+	while(pipe->count == 0){
+
+		if(pipe->writers == 0)
+			return 0;
+		sleep_on(&pipe->wait);
+	}
+
+	n = ((uint32_t)nbytes < pipe->count) ? (uint32_t)nbytes : pipe->count;
+	first = (n < PIPE_SIZE - pipe->start) ? n : PIPE_SIZE - pipe->start;
+
+	// the unread bytes may wrap around the end of data
+	if(copy_to_user(buf, &pipe->data[pipe->start], first) == -1 ||
+		copy_to_user(buf + first, pipe->data, n - first) == -1)
+		return -1;
+
+	pipe->start = (pipe->start + n) % PIPE_SIZE;
+	pipe->count -= n;
+	wake_up(&pipe->wait);
+	return n;
+}
+
+/* pipe_write
+ * DESCRIPTION: puts all of a buffer into a pipe, sleeping whenever it is full
+ * INPUTS: fd - write end of a pipe
+ *		   buf - user buffer
+ *		   nbytes - bytes to write
+ * OUTPUTS: none
+ * RETURN VALUE: nbytes, or how many were written before every read end was closed
+ *				 or a bad part of buf was reached, -1 if that was none
+ * SIDE EFFECTS: wakes readers waiting for data
+ */
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes){
+
+	pipe_t* pipe;
+	uint32_t end;
+	uint32_t n;
+	int32_t written;
+
+	cli();
+	pipe = fd_pipe(fd);
+	written = 0;
+	while(written < nbytes){
+
+		if(pipe->readers == 0)
+			break;
+
+		if(pipe->count == PIPE_SIZE){
+
+			sleep_on(&pipe->wait);
+			continue;
+		}
+
+		// fill the free space up to the end of data, the rest on the next pass
+		end = (pipe->start + pipe->count) % PIPE_SIZE;
+		n = nbytes - written;
+		if(n > PIPE_SIZE - pipe->count)
+			n = PIPE_SIZE - pipe->count;
+		if(n > PIPE_SIZE - end)
+			n = PIPE_SIZE - end;
+
+		if(copy_from_user(&pipe->data[end], (const uint8_t*)buf + written, n) == -1)
+			break;
+
+		pipe->count += n;
+		written += n;
+		wake_up(&pipe->wait);
+	}
+
+	return (written == 0 && nbytes != 0) ? -1 : written;
+}
+
+/* pipe_no_read, pipe_no_write
+ * DESCRIPTION: the read entry of a write end and the write entry of a read end
+ * INPUTS: ignored
+ * OUTPUTS: none
+ * RETURN VALUE: -1
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_no_read(int32_t fd, uint8_t* buf, int32_t nbytes){
+
+	return -1;
+}
+
+int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes){
+
+	return -1;
+}
+
+/* pipe_open
+ * DESCRIPTION: pipes have no name, they are made by sys_pipe
+ * INPUTS: filename - ignored
+ * OUTPUTS: none
+ * RETURN VALUE: -1
+ * SIDE EFFECTS: none
+ */
+int32_t pipe_open(const uint8_t* filename){
+
+	return -1;
+}
+
+/* pipe_close
+ * DESCRIPTION: closes one end of a pipe, freeing the pipe when no fd is left on it
+ * INPUTS: fd - either end of a pipe
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: wakes the other side so it sees the end of file or has nobody to
+ *				 write to
+ */
+int32_t pipe_close(int32_t fd){
+
+	pipe_t* pipe;
+
+	cli();
+	pipe = fd_pipe(fd);
+	if(get_process_pcb(executing_process)->fd_array[fd].jtable->read == pipe_read)
+		pipe->readers--;
+	else
+		pipe->writers--;
+
+	wake_up(&pipe->wait);
+	if(pipe->readers == 0 && pipe->writers == 0)
+		frames_free((uint32_t)pipe, 1);
+
+	return 0;
+}
+
+/* fd_pipe
+ * DESCRIPTION: finds the pipe behind an fd of the executing process
+ * INPUTS: fd - an end of a pipe
+ * OUTPUTS: none
+ * RETURN VALUE: the pipe
+ * SIDE EFFECTS: none
+ */
+static pipe_t* fd_pipe(int32_t fd){
+
+	return (pipe_t*)get_process_pcb(executing_process)->fd_array[fd].inode_ptr;
+}
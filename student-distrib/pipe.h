@@ -0,0 +1,42 @@
+/* pipe.h - one way byte streams between processes
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _PIPE_H
+#define _PIPE_H
+
+#include "types.h"
+#include "system_calls.h"
+#include "wait_queue.h"
+
+#define PIPE_SIZE 4072	/* bytes a pipe holds, so the pipe fills one frame */
+
+/* A ring buffer shared by every file descriptor open on either end. The fd's
+   inode_ptr points at it, and its jtable says which end the fd is */
+typedef struct pipe_t{
+
+	uint32_t start;		/* index of the first unread byte */
+	uint32_t count;		/* unread bytes */
+	uint32_t readers;	/* read ends open, in all processes */
+	uint32_t writers;	/* write ends open */
+	wait_queue_t wait;	/* readers waiting for data and writers waiting for room */
+	uint8_t data[PIPE_SIZE];
+}pipe_t;
+
+/* Externally-visible functions */
+
+/* Makes a pipe with one reader and one writer, NULL if there is no memory */
+pipe_t* pipe_alloc(void);
+
+/* Counts another fd open on the pipe file points at, does nothing for other files */
+void pipe_share(file_descriptor* file);
+
+/* function_table entries of the two ends */
+int32_t pipe_read(int32_t fd, uint8_t* buf, int32_t nbytes);
+int32_t pipe_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t pipe_no_read(int32_t fd, uint8_t* buf, int32_t nbytes);
+int32_t pipe_no_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t pipe_open(const uint8_t* filename);
+int32_t pipe_close(int32_t fd);
+
+#endif /* _PIPE_H */
@@ -5,9 +5,11 @@
 #include "rtc.h"
 #include "lib.h"
 #include "i8259.h"
+#include "paging.h"
+#include "wait_queue.h"
 
 volatile int RTC_IS_OPEN = 0;
-volatile int rtc_int_flag = 0;
+static wait_queue_t rtc_wait = {NULL, NULL, 1}; // processes in rtc_read
 
 /* 
  * rtc_init
@@ -44,9 +46,9 @@ rtc_init(void)
  * rtc_interrupt_handler
  *   DESCRIPTION: Serves as the interrupt handler for RTC
  *   INPUTS: none
- *   OUTPUTS: Sets rtc_int_flag to 1
+ *   OUTPUTS: counts the interrupt in rtc_ticks
  *   RETURN VALUE: none
- *   SIDE EFFECTS: 
+ *   SIDE EFFECTS: wakes the processes waiting in rtc_read
  */
 void rtc_interrupt_handler()
 {
@@ -54,7 +56,8 @@ void rtc_interrupt_handler()
     inb(RTC_CMOS_PORT);
     //test_interrupts();
     //printf("RTC Interrupt\n");
-    rtc_int_flag = 1;
+    kernel_data->rtc_ticks++;
+    wake_up(&rtc_wait);
     send_eoi(8);
     asm("sti");
 }
@@ -104,17 +107,21 @@ int32_t rtc_close(int32_t fd)
  * rtc_read
  *   DESCRIPTION: rtc_read function, reads data from the RTC
  *      Wait until after RTC interrupt is generated before returning 
- *      (set a flag and wait for interrupt handler to clear it)
+ *      (sleep until the interrupt handler has counted another tick)
  *   INPUTS: fd, buf, nbytes
  *   OUTPUTS: none
  *   RETURN VALUE: 0 when RTC interrupt occurs
- *   SIDE EFFECTS: none
+ *   SIDE EFFECTS: the process is not scheduled while it waits
  */
 int32_t rtc_read (int32_t fd, uint8_t* buf, int32_t nbytes)
 {
-    asm("sti");
-    rtc_int_flag = 0;
-    while(rtc_int_flag == 0){};
+    uint32_t ticks;
+
+    cli();
+    ticks = kernel_data->rtc_ticks;
+    while(kernel_data->rtc_ticks == ticks)
+        sleep_on(&rtc_wait);
+    sti();
     return 0;
 
 }
@@ -133,10 +140,11 @@ int32_t rtc_read (int32_t fd, uint8_t* buf, int32_t nbytes)
  */
 int32_t rtc_write (int32_t fd, const void* buf, int32_t nbytes)
 {
-    asm("cli");
     char out_bits = 0x00;
     int32_t frequency;
-    frequency = *((int32_t*)buf);
+    if(copy_from_user(&frequency, buf, sizeof(int32_t)) == -1)
+        return -1;
+    asm("cli");
     /* check input value to choose bits which should be put in reg A */
     if(frequency == 0)
         out_bits = 0x0;
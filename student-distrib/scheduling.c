@@ -8,12 +8,65 @@
  
 #define CHANNEL0 0x40
 #define CMD_REG 0x43
-#define PIT_INPUT 0x30
+#define PIT_INPUT 0x30 // channel 0, low then high byte, mode 0: one interrupt per count written
 #define FREQ_DIVISOR 59659
-
-#define GARBAGE 1234
-int32_t task_list[6] = {GARBAGE, GARBAGE, GARBAGE, GARBAGE, GARBAGE, GARBAGE};
-int32_t number_of_processes = 0;
+#define PIT_FREQ 1193182 // input clock of the PIT in Hz
+#define CHANNEL2 0x42
+#define SPEAKER_PORT 0x61 // gates channel 2 and reads back its output
+#define CHANNEL2_GATE 0x01
+#define SPEAKER_ON 0x02
+#define CHANNEL2_OUT 0x20
+#define CHANNEL2_ONESHOT 0xB0 // channel 2, low then high byte, mode 0
+#define CALIBRATE_MS 10
+#define CALIBRATE_COUNT (PIT_FREQ / (1000 / CALIBRATE_MS))
+#define CALIBRATE_SPINS 0x1000000 // give up if channel 2 never fires
+
+#define IDLE_STACK_WORDS 1024
+#define MLFQ_BOOST_TICKS 20 // PIT periods between raising every task to its top level, a second
+#define PREEMPT_COUNT 1 // PIT count that interrupts at once
+uint32_t pit_interrupted_cs = 0; /* set by pit_handler, USER_CS if a program was running */
+
+static uint32_t idle_stack[IDLE_STACK_WORDS]; // kernel stack of the idle task
+static uint32_t idle_esp; // where the idle task resumes, saved when it switches to a process
+static uint32_t idle_running = 0; // 1 while the idle task has the processor
+static uint64_t idle_cycles = 0; // idle time stamp counter ticks not yet in kernel_data->idle_ms
+static uint32_t tickless = 0; // 1 if TICKLESS was asked for and the time stamp counter can keep time
+static uint32_t timer_stopped = 0; // 1 while channel 0 has no count, no PIT interrupt will come
+static uint32_t clock_cycles; // time stamp counter ticks per PIT period
+static uint64_t clock_tsc; // time stamp counter when pit_ticks was last brought up to date
+static uint32_t timer_count = FREQ_DIVISOR; // PIT count last armed
+static uint32_t timer_periods = 0; // PIT counts that expired and are not yet in pit_ticks
+static uint32_t preempting = 0; // 1 if the coming PIT interrupt is for a task woken above the running one
+static uint32_t last_boost = 0; // pit_ticks when every task was last raised to its top level
+static uint32_t boost_epoch = 0; // boosts so far, a task that has not seen the last one is due it
+
+/* Runnable tasks at one MLFQ level, first in first out, linked through run_next.
+   The running task is on none */
+typedef struct run_queue_t{
+
+	PCB_struct* first;
+	PCB_struct* last;
+}run_queue_t;
+
+static run_queue_t run_queue[MLFQ_LEVELS];
+static uint32_t run_bitmap = 0; // bit n set while run_queue[n] is not empty
+
+/* PIT count of a quantum at each MLFQ level, a level runs only when no task
+   above it can and gets twice the time of the one above */
+static const uint32_t level_quantum[MLFQ_LEVELS] = {
+	FREQ_DIVISOR / 8, FREQ_DIVISOR / 4, FREQ_DIVISOR / 2, FREQ_DIVISOR
+};
+
+static void switch_to(uint32_t* save_esp, int32_t new_process);
+static void timer_arm(uint32_t count);
+static void timer_next(void);
+static void timer_wake(uint32_t level);
+static void idle_task(void);
+static uint32_t tsc_periods(uint64_t* cycles, uint32_t period);
+static void run_queue_add(PCB_struct* control_block);
+static PCB_struct* run_queue_pop(void);
+static void run_queue_boost(void);
+static uint32_t run_queue_top(void);
 
 /* 
  * task_switcher
@@ -26,52 +79,186 @@ int32_t number_of_processes = 0;
 
 void task_switcher(int32_t old_process, int32_t new_process)
 {
-	uint32_t new_esp;
-	uint32_t new_ebp;
+	PCB_struct * old_control_block;
+	old_control_block = get_process_pcb(old_process);
 
+	/* old_process continues from here when it is switched back to */
+	switch_to(&old_control_block->curr_esp, new_process);
+}
 
-	
+/* 
+ * switch_to
+ *   DESCRIPTION: context switches from whatever is running, a process or the idle task,
+ *				  to new_process
+ *   INPUTS: save_esp - where the context of what is running is kept until it is
+ *					   switched back to
+ *			 new_process - process to run
+ *   OUTPUTS: Changes executing process to new process, changes tss.esp0 for new executing process
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: returns once the caller is switched back to
+ */
+static void switch_to(uint32_t* save_esp, int32_t new_process)
+{
+	PCB_struct * new_control_block;
+	new_control_block = get_process_pcb(new_process);
 
+	page_allocator(new_process);
+	tss.esp0 = new_control_block->kernel_stack;
+	new_control_block->state = TASK_RUNNING;
 
-	PCB_struct * old_control_block;
-	old_control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (old_process + 2)));
-	PCB_struct * new_control_block;
-	new_control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (new_process + 2)));
+	executing_process = new_process;
+	kernel_data->pid = new_process;
+	executing_control_block = get_process_pcb(executing_process);
 
+	timer_next();
 
+	switch_context(save_esp, new_control_block->curr_esp);
+}
 
-	
+/* 
+ * idle_init
+ *   DESCRIPTION: sets up the idle task, which has the processor whenever no process
+ *				  can run. It is not a process and has no PCB, only a kernel stack
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void idle_init(void)
+{
+	idle_esp = initial_context(&idle_stack[IDLE_STACK_WORDS], (uint32_t)idle_task);
+}
 
-	/* Store old_process's esp and ebp*/
-	asm("\t movl %%esp, %0" : "=r"(old_control_block->curr_esp));
-	asm("\t movl %%ebp, %0" : "=r"(old_control_block->curr_ebp));
-	
-	page_allocator(new_process);
-	/* redirect esp and ebp to new_process */
-	new_esp = new_control_block->curr_esp;
-	//tss.esp0 = new_esp;
-	new_ebp = new_control_block->curr_ebp;
-	// tss.ebp = new_ebp;
-	tss.esp0 = KERNEL_MEM_BOTTOM - (KB8) * (new_process + 1) - 4;
+/* 
+ * idle_task
+ *   DESCRIPTION: halts the processor until an interrupt makes a process runnable, then
+ *				  switches to it. Time spent halted is added to kernel_data->idle_ms
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: never returns
+ *   SIDE EFFECTS: executing_process is left as the process that ran last, interrupt
+ *				  handlers taken here see it as the running process
+ */
+static void idle_task(void)
+{
+	PCB_struct * next;
+	uint64_t start;
 
-	executing_process = new_process;
-	executing_control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	while(1){
 
-	//reset PIT
-	outb((FREQ_DIVISOR & 0xFF), CHANNEL0);
-	outb((FREQ_DIVISOR >> 8), CHANNEL0);
+		cli();
+		next = run_queue_pop();
+		if(next != NULL){
 
- //    asm("sti");
-	// go_to_user_mode(new_esp);
+			idle_running = 0;
+			switch_to(&idle_esp, next->process_ID);
+			continue;
+		}
+		timer_next();
 
-	asm volatile("movl %0, %%esp ;" :: "g"(new_esp)); 	
-	asm volatile("movl %0, %%ebp ;" :: "g"(new_ebp));	
-	// asm volatile("jmp switchProgram");
-	//asm volatile("leave");
-	//asm volatile("ret");		  
-	
+		// sti only takes effect after the next instruction, so an interrupt
+		// cannot come in between and leave hlt waiting for the one after it
+		start = rdtsc64();
+		asm volatile("sti; hlt");
+		cli();
 
-	return;
+		// with the PIT stopped a halt can last longer than the low half of the counter
+		if(kernel_data->tsc_khz != 0){
+
+			idle_cycles += rdtsc64() - start;
+			kernel_data->idle_ms += tsc_periods(&idle_cycles, kernel_data->tsc_khz);
+		}
+	}
+}
+
+/* 
+ * tsc_periods
+ *   DESCRIPTION: divides a count of time stamp counter ticks into whole periods
+ *				  without a 64 bit division, which the kernel has no library for
+ *   INPUTS: cycles - the ticks, left holding what is less than a period
+ *		     period - ticks per period, not 0
+ *   OUTPUTS: *cycles
+ *   RETURN VALUE: number of whole periods
+ *   SIDE EFFECTS: none
+ */
+static uint32_t tsc_periods(uint64_t* cycles, uint32_t period)
+{
+	uint32_t periods;
+	uint32_t chunk;
+
+	periods = 0;
+	chunk = 0xFFFFFFFF / period;
+	while((*cycles >> 32) != 0){
+
+		periods += chunk;
+		*cycles -= (uint64_t)chunk * period;
+	}
+	periods += (uint32_t)*cycles / period;
+	*cycles = (uint32_t)*cycles % period;
+	return periods;
+}
+
+/* 
+ * running_esp
+ *   DESCRIPTION: for code outside the scheduler that switches away from whatever is
+ *				  running with switch_context, gives where its context is kept
+ *   INPUTS: control_block - the executing process
+ *   OUTPUTS: none
+ *   RETURN VALUE: the idle task's if it is running, else control_block's curr_esp
+ *   SIDE EFFECTS: the idle task counts as switched away from, a process goes back on
+ *				  its run queue
+ */
+uint32_t* running_esp(PCB_struct* control_block)
+{
+	if(idle_running == 1){
+
+		idle_running = 0;
+		return &idle_esp;
+	}
+
+	run_queue_add(control_block);
+	timer_wake(MLFQ_LEVELS);
+	return &control_block->curr_esp;
+}
+
+/* 
+ * tsc_calibrate
+ *   DESCRIPTION: measures the time stamp counter against a CALIBRATE_MS one shot of
+ *				  PIT channel 2, which is otherwise unused (it drives the speaker)
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: time stamp counter ticks per millisecond, 0 if channel 2 never fired
+ *   SIDE EFFECTS: busy waits for CALIBRATE_MS
+ */
+
+static uint32_t tsc_calibrate(void){
+
+	uint32_t speaker;
+	uint32_t start;
+	uint32_t end;
+	uint32_t spins;
+
+	speaker = inb(SPEAKER_PORT);
+	outb((speaker & ~SPEAKER_ON) | CHANNEL2_GATE, SPEAKER_PORT);
+
+	outb(CHANNEL2_ONESHOT, CMD_REG);
+	outb((CALIBRATE_COUNT & 0xFF), CHANNEL2);
+	outb((CALIBRATE_COUNT >> 8), CHANNEL2);
+
+	start = rdtsc();
+	for(spins = 0; spins < CALIBRATE_SPINS; spins++){
+
+		if(inb(SPEAKER_PORT) & CHANNEL2_OUT)
+			break;
+	}
+	end = rdtsc();
+
+	outb(speaker, SPEAKER_PORT);
+
+	if(spins == CALIBRATE_SPINS)
+		return 0;
+
+	return (end - start) / CALIBRATE_MS;
 }
 
 /* 
@@ -85,12 +272,125 @@ void task_switcher(int32_t old_process, int32_t new_process)
 
 void pit_init(void){
 
-	outb(PIT_INPUT, CMD_REG);
-	outb((FREQ_DIVISOR & 0xFF), CHANNEL0);
-	outb((FREQ_DIVISOR >> 8), CHANNEL0);
+	kernel_data->pit_hz = PIT_FREQ / FREQ_DIVISOR;
+	kernel_data->tsc_khz = tsc_calibrate();
+
+	// without ticks to count, pit_ticks is kept from the time stamp counter
+	tickless = (TICKLESS == 1 && kernel_data->tsc_khz != 0);
+	clock_cycles = kernel_data->tsc_khz * (1000 / kernel_data->pit_hz);
+	clock_tsc = rdtsc64();
+	kernel_data->clock_tsc_low = (uint32_t)clock_tsc;
+	kernel_data->clock_tsc_high = (uint32_t)(clock_tsc >> 32);
+	kernel_data->clock_cycles = tickless ? clock_cycles : 0;
+
+	timer_arm(FREQ_DIVISOR);
 	enable_irq(0);
 }
 
+/* 
+ * timer_arm
+ *   DESCRIPTION: starts a quantum, the PIT interrupts once when it is over
+ *   INPUTS: count - length of the quantum in PIT input clocks
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: a quantum already counting starts over
+ */
+static void timer_arm(uint32_t count)
+{
+	outb(PIT_INPUT, CMD_REG);
+	outb((count & 0xFF), CHANNEL0);
+	outb((count >> 8), CHANNEL0);
+	timer_count = count;
+	timer_stopped = 0;
+}
+
+/* 
+ * timer_next
+ *   DESCRIPTION: programs the PIT for the next thing the scheduler has to do. That is
+ *				  the end of the running task's quantum at its level, unless tickless and nothing
+ *				  could take over from it: the idle task runs, or no other task is
+ *				  runnable and the running one has no ring for the tick to drain.
+ *				  Then no interrupt is asked for at all, wake_up and new tasks start
+ *				  the timer again. There are no timed sleeps to wait for
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void timer_next(void)
+{
+	if(tickless == 1 && (idle_running == 1 ||
+		(run_bitmap == 0 && get_process_pcb(executing_process)->ring == NULL))){
+
+		// writing the mode without a count leaves channel 0 waiting
+		outb(PIT_INPUT, CMD_REG);
+		timer_stopped = 1;
+		return;
+	}
+
+	if(idle_running == 1)
+		timer_arm(FREQ_DIVISOR);
+	else
+		timer_arm(level_quantum[get_process_pcb(executing_process)->level]);
+}
+
+/* 
+ * timer_wake
+ *   DESCRIPTION: called when a task may have become runnable. If it is above the running
+ *				  task the PIT interrupts at once so the scheduler switches to it, else
+ *				  the timer is started again if tickless stopped it
+ *   INPUTS: level - MLFQ level of the task, MLFQ_LEVELS if it should not preempt
+ *   OUTPUTS: none
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+static void timer_wake(uint32_t level)
+{
+	// the idle task switches to the woken task itself
+	if(idle_running == 1)
+		return;
+
+	if(level < MLFQ_LEVELS && level < get_process_pcb(executing_process)->level){
+
+		preempting = 1;
+		timer_arm(PREEMPT_COUNT);
+	}
+	else if(timer_stopped == 1)
+		timer_arm(level_quantum[get_process_pcb(executing_process)->level]);
+}
+
+/* 
+ * clock_update
+ *   DESCRIPTION: brings pit_ticks up to date when tickless, counting the PIT periods
+ *				  that passed on the time stamp counter. Called from the PIT interrupt
+ *				  and system call exit, pit_ticks stands still while a program runs
+ *				  alone without system calls, so programs add the periods since
+ *				  clock_tsc themselves (ece391_pit_ticks)
+ *   INPUTS: none
+ *   OUTPUTS: kernel_data->pit_ticks, clock_tsc_low and clock_tsc_high
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void clock_update(void)
+{
+	uint32_t flags;
+	uint64_t now;
+	uint64_t elapsed;
+
+	if(tickless == 0)
+		return;
+
+	// the PIT may have been stopped for longer than the low half of the counter
+	cli_and_save(flags);
+	now = rdtsc64();
+	elapsed = now - clock_tsc;
+	kernel_data->pit_ticks += tsc_periods(&elapsed, clock_cycles);
+	clock_tsc = now - elapsed;
+	kernel_data->clock_tsc_low = (uint32_t)clock_tsc;
+	kernel_data->clock_tsc_high = (uint32_t)(clock_tsc >> 32);
+	restore_flags(flags);
+}
+
 /* 
  * pit_interrupt_handler
  *   DESCRIPTION: functions as pit interrupt handler, calls scheduler function to switch processes
@@ -102,6 +402,20 @@ void pit_init(void){
 void pit_interrupt_handler(void){
 	asm("cli");
 	send_eoi(0);
+	kernel_data->timer_irqs++;
+	if(tickless == 1)
+		clock_update();
+	else{
+
+		// quanta are shorter than a PIT period at the upper levels
+		for(timer_periods += timer_count; timer_periods >= FREQ_DIVISOR; timer_periods -= FREQ_DIVISOR)
+			kernel_data->pit_ticks++;
+	}
+
+	/* queued operations are only safe to run if no system call was interrupted */
+	if((pit_interrupted_cs & 0xFFFF) == USER_CS)
+		ring_poll();
+
 	scheduler();
 	asm("switchProgram:");
 	
@@ -110,181 +424,328 @@ void pit_interrupt_handler(void){
 
 /* 
  * scheduler
- *   DESCRIPTION: scheduler function, called by pit interrupt, checks if process needs to be switched for multitasking, calls task switcher if necessary
+ *   DESCRIPTION: scheduler function, called by pit interrupt, checks if process needs to be switched for multitasking, calls task switcher if necessary.
+ *				  Tasks are kept in MLFQ_LEVELS levels: the running task goes down one
+ *				  when it uses up its quantum, a task raised by wake_up preempts it, and
+ *				  every MLFQ_BOOST_TICKS all tasks go back to the top so none starves.
+ *				  Only runnable tasks are on the run queues, so the cost does not grow
+ *				  with the number of processes
  *   INPUTS: none
- *   OUTPUTS: reorders task_list
+ *   OUTPUTS: reorders the run queues
  *   RETURN VALUE: none
  *   SIDE EFFECTS: processes are switched if needed
  */
 void scheduler()
 {
-	int i;
-	int j;
-	int32_t temp;
-	int32_t new_process = 0;
+	PCB_struct * control_block;
+	PCB_struct * next;
 
-	
-	if(number_of_processes == 1){
-
-	PCB_struct * old_control_block;
-	old_control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process+ 2)));
-	PCB_struct * new_control_block;
-	new_control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (new_process + 2)));
+	//the idle task looks for a runnable process itself once the interrupt returns
+	if(idle_running == 1){
 
-	asm("\t movl %%esp, %0" : "=r"(old_control_block->curr_esp));
-	asm("\t movl %%ebp, %0" : "=r"(old_control_block->curr_ebp));
-	
-	outb((FREQ_DIVISOR & 0xFF), CHANNEL0);
-	outb((FREQ_DIVISOR >> 8), CHANNEL0);
+	timer_next();
 	sti();
 
 	return;
-
-
-	
 	}	
 
-	//check_task_list();		//function to check task_list for correctness
+	control_block = get_process_pcb(executing_process);
+	if(preempting == 0 && control_block->level < MLFQ_LEVELS - 1)
+		control_block->level++;
+	preempting = 0;
 
-	while(1){
-		new_process = task_list[0];
-		if(new_process == GARBAGE)
-		{
-			//reset PIT
-			outb((FREQ_DIVISOR & 0xFF), CHANNEL0);
-			outb((FREQ_DIVISOR >> 8), CHANNEL0);
-			asm("sti");
-			return;
-		}
-		//fix task_list, remove new task from beginning and append to end
-		for(i = 0; i < number_of_processes; i++)
-		{
-			temp = task_list[i];
-			j = i;
-			if(j == 0)
-				continue;
-			else
-				j--;
-			// j--;
-			// j %= 7;
-			task_list[j] = temp;
-		}
-		task_list[number_of_processes - 1] = new_process;
+	if(kernel_data->pit_ticks - last_boost >= MLFQ_BOOST_TICKS){
 
+		last_boost = kernel_data->pit_ticks;
+		run_queue_boost();
+		control_block->boost_epoch = boost_epoch;
+		control_block->level = control_block->nice;
+	}
 
-		if(new_process == executing_process){
+	//the running task keeps the processor unless one at its level or above is waiting
+	if(run_bitmap == 0 || run_queue_top() > control_block->level){
 
-		outb((FREQ_DIVISOR & 0xFF), CHANNEL0);
-		outb((FREQ_DIVISOR >> 8), CHANNEL0);
+		timer_next();
 		sti();
 
+		return;
+	}
+
+	run_queue_add(control_block);
+	next = run_queue_pop();
+	if(next == control_block){
+
+		control_block->state = TASK_RUNNING;
+		timer_next();
+		sti();
 
 		return;
-		}
+	}
+
+	task_switcher(executing_process, next->process_ID);
 
-		
+	return; 
+}
 
+/* 
+ * schedule_away
+ *   DESCRIPTION: switches to the next process that can run, for a process that cannot
+ *				  go on: one that has halted or gone to sleep, and so is on no run
+ *				  queue. If there is none the idle task runs until there is
+ *   INPUTS: none
+ *   OUTPUTS: reorders the run queues
+ *   RETURN VALUE: none, returns once the caller is scheduled again
+ *   SIDE EFFECTS: a halted caller never is, its kernel stack is freed later
+ */
+void schedule_away(void)
+{
+	PCB_struct * control_block;
+	PCB_struct * next;
 
-		PCB_struct * new_control_block;
-		new_control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (new_process + 2)));
-		//only schedule tasks which don't have children
+	next = run_queue_pop();
+	if(next != NULL){
 
-		
-		if(new_control_block->child_exists == 0)
-			break;
+		task_switcher(executing_process, next->process_ID);
+		return;
 	}
 
+	//nothing can run until an interrupt changes that
+	control_block = get_process_pcb(executing_process);
+	idle_running = 1;
+	switch_context(&control_block->curr_esp, idle_esp);
+}
 
+/* 
+ * sleep_on
+ *   DESCRIPTION: blocks the executing process until wake_up is called on queue. The
+ *				  caller has interrupts off from checking what it waits for until
+ *				  here, so a wake_up from an interrupt handler cannot slip in between
+ *   INPUTS: queue - what is waited for
+ *   OUTPUTS: marks the executing process blocked
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: other processes run meanwhile, wake_up wakes every sleeper so the
+ *				  caller checks again what it waited for
+ */
+void sleep_on(wait_queue_t* queue)
+{
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+
+	cli();
+	control_block->wait_next = NULL;
+	if(queue->last == NULL)
+		queue->first = control_block;
+	else
+		queue->last->wait_next = control_block;
+	queue->last = control_block;
+
+	control_block->state = TASK_BLOCKED;
+	schedule_away();
+}
 
-	task_switcher(executing_process, new_process);
+/* 
+ * wake_up
+ *   DESCRIPTION: puts every process sleeping on queue on its run queue, in the order
+ *				  they went to sleep. Sleepers on a boost queue go back to their top
+ *				  MLFQ level, and one above the running task preempts it
+ *   INPUTS: queue - what was waited for
+ *   OUTPUTS: empties queue, modifies the run queues
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: none
+ */
+void wake_up(wait_queue_t* queue)
+{
+	PCB_struct * control_block;
+	uint32_t level;
 
-	return; 
+	if(queue->first == NULL)
+		return;
+
+	level = MLFQ_LEVELS;
+	while(queue->first != NULL){
+
+		control_block = queue->first;
+		queue->first = control_block->wait_next;
+		if(queue->boost == 1)
+			control_block->level = control_block->nice;
+		run_queue_add(control_block);
+		if(control_block->level < level)
+			level = control_block->level;
+	}
+	queue->last = NULL;
+	timer_wake(level);
 }
 
 /* 
- * check_task_list
- *   DESCRIPTION: check task list function which is called to check and reorder tasks in task list,
- *				should have tasks in order starting at position 0 with no empty spots
- *   INPUTS: none
- *   OUTPUTS: reorders task_list
+ * add_runnable_task
+ *   DESCRIPTION: puts a process that has just been made, and is not run at once, on
+ *				  its run queue
+ *   INPUTS: process_num
+ *   OUTPUTS: modifies the run queues
  *   RETURN VALUE: none
- *   SIDE EFFECTS: processes are switched if needed
+ *   SIDE EFFECTS: it preempts the running task if it is at a higher level
  */
+void add_runnable_task(int32_t process_num)
+{
+	PCB_struct * control_block;
+	control_block = get_process_pcb(process_num);
+
+	run_queue_add(control_block);
+	timer_wake(control_block->level);
+}
 
-void check_task_list()
+/* 
+ * run_queue_add
+ *   DESCRIPTION: puts a task at the back of the run queue of its MLFQ level, first
+ *				  taking it to its top level if it missed a boost while off the queues
+ *   INPUTS: control_block - the task
+ *   OUTPUTS: modifies the run queues
+ *   RETURN VALUE: none
+ *   SIDE EFFECTS: the task is marked runnable
+ */
+static void run_queue_add(PCB_struct* control_block)
 {
-	int i;
-	int j;
-	int unused_entry;
-	for( i = 0; i < 5; i++)
-	{
-		//if task_list entry isn't full, scan list to fill it
-		if(task_list[i] < 0 || task_list[i] > 5)
-		{
-			unused_entry = i;
-			//find next entry filled with a process
-			for( j = unused_entry; j < 6; j++)
-			{
-				if(task_list[j] >= 0 && task_list[j] <= 5)
-				{
-					task_list[unused_entry] = task_list[j];
-					task_list[j] = GARBAGE;
-					break;
-				}
-			}
-		}
+	run_queue_t* queue;
+
+	if(control_block->boost_epoch != boost_epoch){
+
+		control_block->boost_epoch = boost_epoch;
+		control_block->level = control_block->nice;
 	}
-	return;
+
+	queue = &run_queue[control_block->level];
+	control_block->state = TASK_RUNNABLE;
+	control_block->run_next = NULL;
+	if(queue->last == NULL)
+		queue->first = control_block;
+	else
+		queue->last->run_next = control_block;
+	queue->last = control_block;
+	run_bitmap |= 1 << control_block->level;
 }
 
 /* 
- * add_task_list_entry 
- *   DESCRIPTION: Called to add a new process into the task list 
- *   INPUTS: process_num
- *   OUTPUTS: modifies task_list
- *   RETURN VALUE: returns -1
+ * run_queue_pop
+ *   DESCRIPTION: takes the task at the front of the highest non-empty run queue. A
+ *				  boost moves every queue to the top in one go, so a task found there
+ *				  that its nice value keeps lower is moved down on the way, at most
+ *				  once a boost
+ *   INPUTS: none
+ *   OUTPUTS: modifies the run queues
+ *   RETURN VALUE: the task, NULL if none is runnable
  *   SIDE EFFECTS: none
  */
-int32_t add_task_list_entry(int32_t process_num)
+static PCB_struct* run_queue_pop(void)
 {
-	//check_task_list();
-	if(number_of_processes > 5){
-		return -1;
-	}
-	int i;
-	for(i = 0; i < 7; i++)
-	{
-		if(task_list[i] == GARBAGE)
-		{
-			task_list[i] = process_num;
-			break;
+	PCB_struct * control_block;
+	run_queue_t* queue;
+	uint32_t level;
+
+	while(run_bitmap != 0){
+
+		level = run_queue_top();
+		queue = &run_queue[level];
+		control_block = queue->first;
+		queue->first = control_block->run_next;
+		if(queue->first == NULL){
+
+			queue->last = NULL;
+			run_bitmap &= ~(1 << level);
 		}
+
+		if(control_block->boost_epoch != boost_epoch){
+
+			control_block->boost_epoch = boost_epoch;
+			control_block->level = control_block->nice;
+			if(control_block->level != level){
+
+				run_queue_add(control_block);
+				continue;
+			}
+		}
+		return control_block;
 	}
 
-	//task_list[number_of_processes] = process_num;
-	number_of_processes++;
-	return -1;
+	return NULL;
 }
 
 /* 
- * add_task_list_entry 
- *   DESCRIPTION: Called to delete a halted process from the task list 
- *   INPUTS: process_num
- *   OUTPUTS: modifies task_list
+ * run_queue_boost
+ *   DESCRIPTION: moves every runnable task to the top run queue, keeping their order
+ *				  level by level. Levels are put right by run_queue_pop and run_queue_add
+ *   INPUTS: none
+ *   OUTPUTS: modifies the run queues
  *   RETURN VALUE: none
- *   SIDE EFFECTS: calls check task list to reorder task list
+ *   SIDE EFFECTS: tasks off the queues are due the boost the next time they are added
  */
- void delete_task_list_entry(int32_t process_num)
+static void run_queue_boost(void)
 {
-	int i;
-	for(i = 0; i < 7; i++)
-	{
-		if(task_list[i] == process_num)
-		{
-			task_list[i] = GARBAGE;
-			break;
-		}
+	uint32_t level;
+
+	boost_epoch++;
+	for(level = 1; level < MLFQ_LEVELS; level++){
+
+		if(run_queue[level].first == NULL)
+			continue;
+
+		if(run_queue[0].last == NULL)
+			run_queue[0].first = run_queue[level].first;
+		else
+			run_queue[0].last->run_next = run_queue[level].first;
+		run_queue[0].last = run_queue[level].last;
+		run_queue[level].first = NULL;
+		run_queue[level].last = NULL;
 	}
-	number_of_processes--;
-	check_task_list();
+
+	if(run_queue[0].first != NULL)
+		run_bitmap = 1;
+}
+
+/* 
+ * run_queue_top
+ *   DESCRIPTION: finds the highest MLFQ level with a runnable task
+ *   INPUTS: none
+ *   OUTPUTS: none
+ *   RETURN VALUE: the level, run_bitmap must not be 0
+ *   SIDE EFFECTS: none
+ */
+static uint32_t run_queue_top(void)
+{
+	uint32_t level;
+
+	asm("bsfl %1, %0" : "=r"(level) : "r"(run_bitmap));
+	return level;
+}
+
+/* 
+ * sys_nice
+ *   DESCRIPTION: moves the highest MLFQ level the executing process may reach, which
+ *				  boosts take it back to, down or up
+ *   INPUTS: increment - added to its nice value, which is kept from 0, the top
+ *						level, to MLFQ_LEVELS - 1
+ *   OUTPUTS: none
+ *   RETURN VALUE: the new nice value
+ *   SIDE EFFECTS: the process drops to that level at once if it was above it
+ */
+int32_t sys_nice(int32_t increment)
+{
+	PCB_struct * control_block;
+	int32_t nice;
+
+	control_block = get_process_pcb(executing_process);
+	if(increment > MLFQ_LEVELS)
+		increment = MLFQ_LEVELS;
+	if(increment < -MLFQ_LEVELS)
+		increment = -MLFQ_LEVELS;
+
+	nice = (int32_t)control_block->nice + increment;
+	if(nice < 0)
+		nice = 0;
+	if(nice > MLFQ_LEVELS - 1)
+		nice = MLFQ_LEVELS - 1;
+
+	control_block->nice = nice;
+	if(control_block->level < control_block->nice)
+		control_block->level = control_block->nice;
+	return nice;
 }
@@ -6,11 +6,18 @@
 #include "paging.h"
 #include "i8259.h"
 #include "terminal.h"
+#include "wait_queue.h"
+
+#define MLFQ_LEVELS 4	/* scheduling priorities, 0 runs first */
+#define TICKLESS 1	/* 1 to stop the PIT while nothing could be switched to, 0 to interrupt every quantum */
 
 void task_switcher(int32_t old_process, int32_t new_process);
+void idle_init(void);
+void clock_update(void);
+int32_t sys_nice(int32_t increment);
+uint32_t* running_esp(PCB_struct* control_block);
 void scheduler();
-void check_task_list();
-int32_t add_task_list_entry(int32_t process_num);
-void delete_task_list_entry(int32_t process_num);
+void schedule_away(void);
+void add_runnable_task(int32_t process_num);
 void pit_interrupt_handler(void);
 void pit_init(void);
@@ -8,11 +8,25 @@
 #include "x86_desc.h"
 #include "i8259.h"
 
+#define SYSCALL_INT_FRAME 48	/* bytes system_call and the processor push below tss.esp0 */
+#define SYSCALL_SYSENTER_FRAME 24	/* bytes sysenter_call pushes below tss.esp0 */
+#define SYSCALL_ENTRY_INT 1	/* the entry code leaves which way a call came in in the word at */
+#define SYSCALL_ENTRY_SYSENTER 2	/* tss.esp0, which no frame reaches */
+#define SWITCH_REGS 4	/* registers switch_context keeps under its return address */
+
 int32_t system_call(void);
+int32_t sysenter_call(void);
+void sysenter_init(void);
+extern uint32_t sysenter_enabled;
 int32_t set_terminal_shell(uint32_t temp);
 
 void go_to_user_mode(uint32_t temp);
 
 void end_program(void);
 
+void switch_context(uint32_t* save_esp, uint32_t new_esp);
+
+void fork_child_int(void);
+void fork_child_sysenter(void);
+
 #endif /* _SYSCALL_LINK_H */
@@ -0,0 +1,275 @@
+/* syscall_stats.c - keeps a log2 latency histogram and a call count for every
+ * system call, for the whole system and for each of the first STATS_PROCESSES
+ * process numbers, and renders them as text for the STATS_NAME file
+ * vim:ts=4 noexpandtab
+ */
+
+#include "syscall_stats.h"
+#include "lib.h"
+#include "system_calls.h"
+#include "scheduling.h"
+
+#define NUM_BUF_SIZE 12
+#define NAME_WIDTH 12
+
+syscall_stats_t global_stats;
+syscall_stats_t process_stats[STATS_PROCESSES];
+
+static const int8_t* syscall_names[] = {
+	"", "halt", "execute", "read", "write", "open", "close", "getargs", "vidmap",
+	"set_handler", "sigreturn", "getdents", "readv", "writev", "mmap", "lseek", "pread",
+	"sendfile", "ring_setup", "ring_enter", "fork",
+	"spawn", "wait", "pipe", "nice"
+};
+
+/* Where a rendering of the statistics is going: the bytes between start and
+   end of the text are copied to the user buffer buf, the rest are only counted */
+typedef struct stats_out_t{
+
+	uint8_t* buf;
+	uint32_t start;
+	uint32_t end;
+	uint32_t offset;	/* offset in the text of the next byte */
+	int32_t fault;		/* set if a copy to buf failed */
+}stats_out_t;
+
+static void emit_str(stats_out_t* out, const int8_t* s);
+static void emit_num(stats_out_t* out, uint32_t value);
+static void emit_stats(stats_out_t* out, const syscall_stats_t* stats);
+
+/* syscall_account
+ * DESCRIPTION: counts a finished system call in the global histograms and those of
+ *				the executing process
+ * INPUTS: start_tsc - time stamp counter when the call was entered
+ *		   number - system call number
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: brings pit_ticks up to date, every system call leaves through here
+ */
+void syscall_account(uint64_t start_tsc, uint32_t number){
+
+	uint64_t elapsed;
+	uint32_t cycles;
+	uint32_t bucket;
+
+	/* a blocking call can outlast the low half, those all go in the top bucket */
+	elapsed = rdtsc64() - start_tsc;
+	cycles = (elapsed >> 32) ? 0xFFFFFFFF : (uint32_t)elapsed;
+	clock_update();
+	if(number >= STATS_SYSCALLS)
+		return;
+
+	/* index of the highest set bit */
+	bucket = 0;
+	if(cycles != 0)
+		asm("bsrl %1, %0" : "=r"(bucket) : "r"(cycles));
+
+	global_stats.calls[number]++;
+	global_stats.hist[number][bucket]++;
+
+	if(executing_process >= 0 && executing_process < STATS_PROCESSES){
+
+		process_stats[executing_process].calls[number]++;
+		process_stats[executing_process].hist[number][bucket]++;
+	}
+}
+
+/* syscall_stats_reset
+ * DESCRIPTION: clears the histograms of a process
+ * INPUTS: process - process number
+ * OUTPUTS: none
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+void syscall_stats_reset(int32_t process){
+
+	if(process >= 0 && process < STATS_PROCESSES)
+		memset((void*)&process_stats[process], 0, sizeof(syscall_stats_t));
+}
+
+/* stats_read
+ * DESCRIPTION: reads the statistics as text, first for the whole system and then for
+ *				every process below STATS_PROCESSES that has made a call. The text is
+ *				rendered again on every read, so a long dump can mix numbers from
+ *				before and after later calls
+ * INPUTS: fd - file descriptor
+ *		   buf - buffer to fill
+ *		   nbytes - size of buf
+ * OUTPUTS: copies the text from the file position on into buf
+ * RETURN VALUE: number of bytes read, 0 at the end of the text, -1 if buf is bad
+ * SIDE EFFECTS: moves the file position past the bytes read
+ */
+int32_t stats_read(int32_t fd, uint8_t* buf, int32_t nbytes){
+
+	PCB_struct * control_block;
+	stats_out_t out;
+	uint32_t calls;
+	int32_t i;
+	int32_t j;
+	control_block = get_process_pcb(executing_process);
+
+	if(buf == NULL || bad_userspace_addr(buf, nbytes))
+		return -1;
+
+	out.buf = buf;
+	out.start = control_block->fd_array[fd].position;
+	out.end = out.start + nbytes;
+	out.offset = 0;
+	out.fault = 0;
+
+	emit_str(&out, "all processes\n");
+	emit_stats(&out, &global_stats);
+
+	for(i = 0; i < STATS_PROCESSES; i++){
+
+		calls = 0;
+		for(j = 0; j < STATS_SYSCALLS; j++)
+			calls += process_stats[i].calls[j];
+		if(calls == 0)
+			continue;
+
+		emit_str(&out, "process ");
+		emit_num(&out, i);
+		emit_str(&out, "\n");
+		emit_stats(&out, &process_stats[i]);
+	}
+
+	if(out.fault)
+		return -1;
+	if(out.offset <= out.start)
+		return 0;
+	if(out.offset > out.end)
+		out.offset = out.end;
+
+	control_block->fd_array[fd].position = out.offset;
+	return out.offset - out.start;
+}
+
+/* stats_write
+ * DESCRIPTION: the statistics cannot be written
+ * INPUTS: fd, buf, nbytes - ignored
+ * OUTPUTS: none
+ * RETURN VALUE: -1
+ * SIDE EFFECTS: none
+ */
+int32_t stats_write(int32_t fd, const void* buf, int32_t nbytes){
+
+	return -1;
+}
+
+/* stats_open
+ * DESCRIPTION: not used, the file is opened in sys_open
+ * INPUTS: filename - ignored
+ * OUTPUTS: none
+ * RETURN VALUE: -1
+ * SIDE EFFECTS: none
+ */
+int32_t stats_open(const uint8_t* filename){
+
+	return -1;
+}
+
+/* stats_close
+ * DESCRIPTION: not used, the file is closed in sys_close
+ * INPUTS: fd - ignored
+ * OUTPUTS: none
+ * RETURN VALUE: 0
+ * SIDE EFFECTS: none
+ */
+int32_t stats_close(int32_t fd){
+
+	return 0;
+}
+
+/* emit_stats
+ * DESCRIPTION: renders one line per system call that has been made, giving its
+ *				call count and each nonempty bucket as log2(cycles):calls
+ * INPUTS: out - where the text goes
+ *		   stats - histograms to render
+ * OUTPUTS: text through emit_str
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void emit_stats(stats_out_t* out, const syscall_stats_t* stats){
+
+	int32_t i;
+	int32_t b;
+	uint32_t len;
+
+	for(i = 1; i < STATS_SYSCALLS; i++){
+
+		if(stats->calls[i] == 0)
+			continue;
+
+		emit_str(out, "  ");
+		if(i < sizeof(syscall_names) / sizeof(syscall_names[0])){
+
+			emit_str(out, syscall_names[i]);
+			len = strlen(syscall_names[i]);
+		}
+		else{
+
+			emit_str(out, "sys ");
+			emit_num(out, i);
+			len = NAME_WIDTH;
+		}
+		for(; len < NAME_WIDTH; len++)
+			emit_str(out, " ");
+
+		emit_str(out, " calls ");
+		emit_num(out, stats->calls[i]);
+		emit_str(out, " log2 cycles");
+		for(b = 0; b < STATS_BUCKETS; b++){
+
+			if(stats->hist[i][b] == 0)
+				continue;
+			emit_str(out, " ");
+			emit_num(out, b);
+			emit_str(out, ":");
+			emit_num(out, stats->hist[i][b]);
+		}
+		emit_str(out, "\n");
+	}
+}
+
+/* emit_str
+ * DESCRIPTION: appends a string to the text, copying the part of it that falls in
+ *				the window being read
+ * INPUTS: out - where the text goes
+ *		   s - string to append
+ * OUTPUTS: may write to out->buf
+ * RETURN VALUE: none
+ * SIDE EFFECTS: sets out->fault if the copy fails
+ */
+static void emit_str(stats_out_t* out, const int8_t* s){
+
+	uint32_t begin;	/* offset in the text of s */
+	uint32_t first;
+	uint32_t last;
+
+	begin = out->offset;
+	out->offset += strlen(s);
+
+	first = (begin > out->start) ? begin : out->start;
+	last = (out->offset < out->end) ? out->offset : out->end;
+	if(first >= last)
+		return;
+
+	if(copy_to_user(out->buf + (first - out->start), s + (first - begin), last - first) == -1)
+		out->fault = 1;
+}
+
+/* emit_num
+ * DESCRIPTION: appends a number to the text in decimal
+ * INPUTS: out - where the text goes
+ *		   value - number to append
+ * OUTPUTS: may write to out->buf
+ * RETURN VALUE: none
+ * SIDE EFFECTS: none
+ */
+static void emit_num(stats_out_t* out, uint32_t value){
+
+	int8_t num[NUM_BUF_SIZE];
+
+	emit_str(out, itoa(value, num, 10));
+}
@@ -0,0 +1,32 @@
+/* syscall_stats.h - per system call latency histograms
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _SYSCALL_STATS_H
+#define _SYSCALL_STATS_H
+
+#include "types.h"
+
+#define STATS_SYSCALLS 32	/* call numbers tracked, higher ones are not counted */
+#define STATS_BUCKETS 32	/* bucket b counts calls taking 2^b to 2^(b+1) - 1 cycles, the last also longer ones */
+#define STATS_NAME "syscall_stats"	/* name of the file the histograms are read through */
+#define STATS_PROCESSES 8	/* process numbers below this also get histograms of their own */
+
+typedef struct syscall_stats_t{
+
+	uint32_t calls[STATS_SYSCALLS];
+	uint32_t hist[STATS_SYSCALLS][STATS_BUCKETS];
+}syscall_stats_t;
+
+/* Called by the system call entry code when a handler returns */
+void syscall_account(uint64_t start_tsc, uint32_t number);
+
+/* Clears a process's histograms when a new program starts in its slot */
+void syscall_stats_reset(int32_t process);
+
+int32_t stats_read(int32_t fd, uint8_t* buf, int32_t nbytes);
+int32_t stats_write(int32_t fd, const void* buf, int32_t nbytes);
+int32_t stats_open(const uint8_t* filename);
+int32_t stats_close(int32_t fd);
+
+#endif /* _SYSCALL_STATS_H */
@@ -11,12 +11,23 @@
 #include "paging.h"
 #include "terminal.h"
 #include "scheduling.h"
+#include "syscall_stats.h"
+#include "frames.h"
+#include "pipe.h"
 
 PCB_struct shell_PCB;
 PCB_struct* current_block;
 int SHELL_EXISTS = 0;
 PCB_struct * control_block2;
-uint8_t process_mask = 0x00;
+
+PCB_struct** process_table = NULL;	/* PCB of every process by number, NULL for a free slot */
+int32_t process_table_size = 0;
+
+static int32_t process_alloc(void);
+static void process_free(int32_t process_num);
+static int32_t start_process(const uint8_t * command, int32_t spawn);
+static void orphan_children(PCB_struct* parent);
+static void close_fd(PCB_struct* control_block, int32_t fd);
 
 
 //uint32_t open_processes = 0;
@@ -26,9 +37,121 @@ function_table file_jtable = { file_read, file_write, file_open, file_close};
 function_table terminal_jtable = {terminal_read, terminal_write, terminal_open, terminal_close};
 function_table rtc_jtable = {rtc_read, rtc_write, rtc_open, rtc_close};
 function_table directory_jtable = {dir_read, dir_write, dir_open, dir_close};
+function_table stats_jtable = {stats_read, stats_write, stats_open, stats_close};
+function_table pipe_reader_jtable = {pipe_read, pipe_no_write, pipe_open, pipe_close};
+function_table pipe_writer_jtable = {pipe_no_read, pipe_write, pipe_open, pipe_close};
 
 
 /* sys_execute
+ * DESCRIPTION: copies the program's command into the kernel and runs it with kernel_execute
+ * INPUTS: command - space-separated sequence of words, in user memory
+ * OUTPUTS: none
+ * RETURN VALUES: same as kernel_execute, -1 if command is bad or longer than COMMAND_SIZE
+ * SIDE EFFECTS: same as kernel_execute
+ */
+int32_t sys_execute(const uint8_t * command)
+{
+	uint8_t kernel_command[COMMAND_SIZE];
+
+	if(safe_strncpy((int8_t*)kernel_command, (const int8_t*)command, COMMAND_SIZE) == -1)
+		return -1;
+
+	return kernel_execute(kernel_command);
+}
+
+
+/* sys_spawn
+ * DESCRIPTION: starts a program that runs alongside the caller instead of in its place
+ * INPUTS: command - space-separated sequence of words, in user memory
+ *		   in_fd - caller's fd the program gets as its stdin, -1 for the terminal
+ *		   out_fd - caller's fd the program gets as its stdout, -1 for the terminal
+ * OUTPUTS: none
+ * RETURN VALUES: the new process's number, -1 if command or an fd is bad or the
+ *				  program cannot be started
+ * SIDE EFFECTS: the caller collects the program with sys_wait when it halts
+ */
+int32_t sys_spawn(const uint8_t * command, int32_t in_fd, int32_t out_fd)
+{
+	uint8_t kernel_command[COMMAND_SIZE];
+	PCB_struct* control_block;
+	PCB_struct* child;
+	int32_t process_num;
+
+	control_block = get_process_pcb(executing_process);
+	if((in_fd != -1 && (in_fd < 0 || in_fd > 7 || control_block->fd_array[in_fd].flags == NOT_IN_USE)) ||
+		(out_fd != -1 && (out_fd < 0 || out_fd > 7 || control_block->fd_array[out_fd].flags == NOT_IN_USE)))
+		return -1;
+
+	if(safe_strncpy((int8_t*)kernel_command, (const int8_t*)command, COMMAND_SIZE) == -1)
+		return -1;
+
+	process_num = start_process(kernel_command, 1);
+	if(process_num == -1)
+		return -1;
+
+	child = get_process_pcb(process_num);
+	if(in_fd != -1){
+
+		child->fd_array[0] = control_block->fd_array[in_fd];
+		pipe_share(&child->fd_array[0]);
+	}
+	if(out_fd != -1){
+
+		child->fd_array[1] = control_block->fd_array[out_fd];
+		pipe_share(&child->fd_array[1]);
+	}
+
+	return process_num;
+}
+
+
+/* sys_pipe
+ * DESCRIPTION: makes a pipe and opens both its ends
+ * INPUTS: fds - user array of two, gets the fd of the read end and then of the write end
+ * OUTPUTS: writes fds
+ * RETURN VALUES: 0 on success, -1 if fds is bad, two fds are not free or there is no
+ *				  memory
+ * SIDE EFFECTS: none
+ */
+int32_t sys_pipe(int32_t* fds)
+{
+	PCB_struct* control_block;
+	pipe_t* pipe;
+	int32_t ends[2];
+	int32_t n;
+	int32_t i;
+
+	control_block = get_process_pcb(executing_process);
+	n = 0;
+	for(i = 2; i < 8 && n < 2; i++){
+
+		if(control_block->fd_array[i].flags == NOT_IN_USE)
+			ends[n++] = i;
+	}
+	if(n < 2)
+		return -1;
+
+	if(copy_to_user(fds, ends, sizeof(ends)) == -1)
+		return -1;
+
+	pipe = pipe_alloc();
+	if(pipe == NULL)
+		return -1;
+
+	control_block->fd_array[ends[0]].jtable = &pipe_reader_jtable;
+	control_block->fd_array[ends[1]].jtable = &pipe_writer_jtable;
+	for(i = 0; i < 2; i++){
+
+		control_block->fd_array[ends[i]].inode_ptr = (uint32_t)pipe;
+		control_block->fd_array[ends[i]].position = 0;
+		control_block->fd_array[ends[i]].flags = IN_USE;
+	}
+
+	return 0;
+}
+
+
+/* kernel_execute
  * DESCRIPTION: attempts to load and execute a new program, handing off the processor to the new program until it terminates
  * INPUTS: command - space-separated sequence of words, first word being the file name of the program to be executed
  * OUTPUTS: none
@@ -36,10 +159,25 @@ function_table directory_jtable = {dir_read, dir_write, dir_open, dir_close};
  *				  or a value in the range 0 to 255 if the program executes a halt
  * SIDE EFFECTS: loads and executes the program
  */
-int32_t sys_execute(const uint8_t * command)
+int32_t kernel_execute(const uint8_t * command)
+{
+	return start_process(command, 0);
+}
+
+
+/* start_process
+ * DESCRIPTION: loads a program into a new process. Run by execute it takes the
+ *				processor until it halts, spawned it only joins the task list
+ * INPUTS: command - space-separated sequence of words, first word being the file name of the program to be executed
+ *		   spawn - 1 to return to the caller at once, 0 to wait for the program
+ * OUTPUTS: none
+ * RETURN VALUES: as kernel_execute, or the new process's number if spawn is 1
+ * SIDE EFFECTS: loads the program
+ */
+static int32_t start_process(const uint8_t * command, int32_t spawn)
 {
 	cli();
-	uint8_t  file_name[32] = "";
+	uint8_t  file_name[FNAMESIZE + 1] = "";
 	uint8_t  cmd_args[128] = "";
 	int i;
 	int j;
@@ -47,8 +185,10 @@ int32_t sys_execute(const uint8_t * command)
 	i = 0;
 	j = 0;
 	int32_t process_num;
-	int32_t file_error;
 	int32_t command_read;
+	exec_info_t exe;
+	PCB_struct* previous;
+	uint32_t* stack;
 	command_read = 0;
 
 	int32_t cmd_length;
@@ -68,13 +208,13 @@ int32_t sys_execute(const uint8_t * command)
 
 			if( command[i] != ' '){
 
-				file_name[i] = command[i];
+				if(i < FNAMESIZE)
+					file_name[i] = command[i];
 			}
 
 			else{
 
 				command_read = 1;
-				file_name[i] = '\0';
 			}
 		}
 
@@ -107,69 +247,61 @@ int32_t sys_execute(const uint8_t * command)
 
 /*check if an exit command is called*/
 
-	if(strncmp((int8_t*)file_name, "exit", 4) == 0){
+	if(spawn == 0 && strncmp((int8_t*)file_name, "exit", 4) == 0){
 
 		return sys_halt(69);
 	}
 
-	int32_t bitmask;
-	bitmask = 0x01;
-
-	process_num = -1;
-
-
-	// Allocate for open process, must support six processes
-	for(i = 0; i < 6; i++){
-
-		if((bitmask & ~process_mask)){
-
-			process_mask |= bitmask;
-			process_num = i;
-			break;
-		}
-
-		else{
+	// only regular files with a valid executable header can be executed
+	if(fs_exec_lookup(file_name, &exe) == -1){
 
-			bitmask = bitmask << 1;
-		}
+		return -1;
+	}
 
+	// the process this one is started from, NULL for the first shell at boot
+	previous = get_process_pcb(executing_process);
 
-
-	}
+	// Allocate a process number, kernel stack and page table
+	process_num = process_alloc();
 
 	if(process_num == -1){
 
 		return -1;
 	}
 
-	//set up paging
+	//set up paging, with demand paging the image is read in by the page fault handler
+	program_map_init(process_num);
 	page_allocator(process_num);
 
-    //file loader
-	file_error = fs_load((uint8_t*)file_name, IMAGE_MEM);
-
-	//check
-	if(file_error != 0)
-	{
-		page_allocator(0);
-		bitmask = 0x01;
-		process_mask &= ~(bitmask << process_num);
-		return -1;
-
-	}
-	
 	// PCB should be at top of stack, stack grows towards it
 	//btw SS0 is set in the kernel.c so I don't think we need to alter it
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (process_num + 2)));
+	control_block = get_process_pcb(process_num);
+
+	//file loader, maps or copies every page of the image now
+	control_block->exe = exe;
+	if(DEMAND_PAGED_EXEC == 0)
+		program_load(&exe);
 
 	control_block->process_ID = process_num;
+	control_block->mmap_end = MMAP_START;
+	control_block->ring = NULL;
+	control_block->background = spawn;
+	control_block->exited = 0;
+	control_block->child_status = 0;
+	control_block->child_wait.first = NULL;
+	control_block->child_wait.last = NULL;
+	control_block->child_wait.boost = 0;
+	control_block->child_pcb = NULL;
+
+	// execute and spawn pass on the caller's nice value, a terminal's shell starts at 0
+	control_block->nice = (previous != NULL && IS_TERM_SHELL == 0) ? previous->nice : 0;
+	control_block->level = control_block->nice;
+	control_block->state = TASK_RUNNING;
+	syscall_stats_reset(process_num);
 
 	strcpy((int8_t*)control_block->args,(int8_t*)cmd_args);
 
-	//add process to task_list
-	add_task_list_entry(process_num);
-
 
 	// File_descriptor array is defined at bottom, we need to initialize values for it
 	for(i = 0; i < 8; i++){
@@ -186,7 +318,28 @@ int32_t sys_execute(const uint8_t * command)
 	control_block->curr_esp = control_block->old_esp;
 	control_block->curr_ebp = control_block->old_ebp;
 
-	if(IS_TERM_SHELL == 1){
+	if(spawn == 1){
+
+		// the caller keeps running, nothing in it changes
+		control_block->parent_pcb = previous;
+		control_block->child_exists = 0;
+		control_block->parent_exists = 0;
+		control_block->terminal = previous->terminal;
+		control_block->terminal_shell = 0;
+
+		stdin(control_block);
+		stdout(control_block);
+
+		stack = (uint32_t*)control_block->kernel_stack;
+		*stack = exe.entry_point;
+		*--stack = 0;	/* go_to_user_mode never returns */
+		control_block->curr_esp = initial_context(stack, (uint32_t)go_to_user_mode);
+
+		page_allocator(executing_process);
+		add_runnable_task(process_num);
+		return process_num;
+	}
+	else if(IS_TERM_SHELL == 1){
 
 		
 		control_block->parent_exists = 0;
@@ -196,6 +349,7 @@ int32_t sys_execute(const uint8_t * command)
 		control_block->process_ID = process_num;
 		control_block->terminal = get_active_terminal();
 		executing_process = process_num;
+		kernel_data->pid = process_num;
 		control_block->terminal_shell = 1;
 
 	 	
@@ -203,46 +357,50 @@ int32_t sys_execute(const uint8_t * command)
 	}
 	else{
 
-		control_block->parent_pcb = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+		control_block->parent_pcb = get_process_pcb(executing_process);
 		control_block->child_exists = 0;
 		control_block->parent_exists = 1;
 		control_block->parent_pcb->child_pcb = control_block;
 		control_block->parent_pcb->child_exists = 1;
+		control_block->parent_pcb->state = TASK_BLOCKED;
 		control_block->terminal = control_block->parent_pcb->terminal;
+		control_block->terminal_shell = 0;
 		// open_processes = 2;
 		control_block->process_ID = process_num;
 		executing_process = process_num;
+		kernel_data->pid = process_num;
 	}
 
 
 	//context switch
 	//write to TSS
-	tss.esp0 = KERNEL_MEM_BOTTOM - (KB8) * (process_num + 1) - 4;
-	//tss.ebp = KERNEL_MEM_BOTTOM - (KB8) * (process_num + 1) - 4;	
-	uint8_t buf[4];
-	fs_read((uint8_t*)file_name, buf, 24, 4);
-
-	uint32_t temp;
-	temp = 0;
+	tss.esp0 = control_block->kernel_stack;
 	//int32_t ret_bytes;
-	control_block2 = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
-	
+	control_block2 = get_process_pcb(executing_process);
+
+	stdin(control_block);
+	stdout(control_block);
 
-	temp |= buf[0];
-	temp |= buf[1] << 8;
-	temp |= buf[2] << 16;
-	temp |= buf[3] << 24;
+	// a shell started from a key press leaves the interrupted process to be
+	// scheduled again, it returns from here when it is
+	if(IS_TERM_SHELL == 1 && previous != NULL){
 
-	stdin();
-	stdout();
+		stack = (uint32_t*)control_block->kernel_stack;
+		*stack = exe.entry_point;
+		*--stack = 0;	/* go_to_user_mode never returns */
+		switch_context(running_esp(previous), initial_context(stack, (uint32_t)go_to_user_mode));
+		return 0;
+	}
 
 	sti();
 
-	go_to_user_mode(temp);
+	go_to_user_mode(exe.entry_point);
 
+	// halt_process jumps here on the parent's stack, eax does not survive the
+	// return so the status comes through the PCB
 	asm("halt_program:");
 
-	return 0;
+	return get_process_pcb(executing_process)->child_status;
 }
 
 
@@ -254,6 +412,20 @@ int32_t sys_execute(const uint8_t * command)
  * SIDE EFFECTS: halts the program
  */
 int32_t sys_halt(uint8_t status)
+{
+	return halt_process(status);
+}
+
+
+/* halt_process
+ * DESCRIPTION: terminates the executing process. Unlike sys_halt the status is not
+ *				cut to 8 bits, so the exception handlers can give HALT_EXCEPTION
+ * INPUTS: status - the value execute or sys_wait gives the parent
+ * OUTPUTS: none
+ * RETURN VALUES: should never return to caller
+ * SIDE EFFECTS: halts the program
+ */
+int32_t halt_process(uint32_t status)
 {
 	//restore parents stack pointers
 
@@ -262,87 +434,224 @@ int32_t sys_halt(uint8_t status)
 	uint32_t ebp_old;
 
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 	esp_old = control_block->old_esp;
 	ebp_old = control_block->old_ebp;
 
-	if(control_block->terminal_shell == 1){
-
-		uint8_t buf[4];
-		if( -1 == fs_read((uint8_t*)"shell", buf, 24, 4)){
-			return -1;
-		}
-
-		uint32_t temp;
-		temp = 0;
+	orphan_children(control_block);
 
+	if(control_block->terminal_shell == 1){
 
-		temp |= buf[0];
-		temp |= buf[1] << 8;
-		temp |= buf[2] << 16;
-		temp |= buf[3] << 24;
+		// start the shell over from a clean image
+		program_map_free(executing_process);
+		control_block->mmap_end = MMAP_START;
+		control_block->ring = NULL;
+		page_allocator(executing_process);
+		if(DEMAND_PAGED_EXEC == 0)
+			program_load(&control_block->exe);
 		sti();
 
-		go_to_user_mode(temp);
+		go_to_user_mode(control_block->exe.entry_point);
 
 	}
 
 	/*tss.esp0 = control_block->old_esp;
 	tss.ebp = control_block->old_ebp;*/
 
-	//control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	//control_block = get_process_pcb(executing_process);
 	int i = 0;
 	for(i = 0; i < 8; i++)
 	{
 		if(control_block->fd_array[i].flags != NOT_IN_USE)
 		{
-			sys_close(i);
+			close_fd(control_block, i);
 		}
 	}
 
-	uint8_t bitmask;
-	bitmask = 0x01;
-	// Mark process as closed
-//	open_processes--;
-//	open_processes = (~(bitmask << control_block->process_ID) && open_processes);
+	// Give back every page the process used
+	program_map_free(executing_process);
+	control_block->mmap_end = MMAP_START;
+	control_block->ring = NULL;
+
+	// nobody waits in execute for a background process, it stops being scheduled
+	// and keeps its status until its parent collects it with sys_wait
+	if(control_block->background == 1){
+
+		control_block->state = TASK_DEAD;
+		control_block->exit_status = status;
+		control_block->exited = 1;
+		if(control_block->parent_pcb != NULL)
+			wake_up(&control_block->parent_pcb->child_wait);
+		schedule_away();
+	}
 
-	process_mask &= ~(bitmask << control_block->process_ID);
 	control_block->parent_pcb->child_exists = 0;
 	control_block->parent_pcb->child_pcb = NULL;
 
-	tss.esp0 = KERNEL_MEM_BOTTOM - (KB8) * (control_block->parent_pcb->process_ID + 1) - 4;
-	//tss.ebp = ebp_old;
-
-	//remove halting process from task list
-	delete_task_list_entry(executing_process);
+	//the parent runs again straight away, it was on no run queue while it waited
+	control_block->state = TASK_DEAD;
+	control_block->parent_pcb->state = TASK_RUNNING;
+	control_block->parent_pcb->child_status = status;
 
 
 	int process_num;
+	int halted_process;
+	halted_process = executing_process;
 	process_num = control_block->parent_pcb->process_ID;			//for now, will always return to shell
 	executing_process = process_num;
+	kernel_data->pid = process_num;
 	page_allocator(process_num);
 
-	tss.esp0 = KERNEL_MEM_BOTTOM - (KB8) * (control_block->parent_pcb->process_ID + 1) - 4;
-	//only return 8 bits
-	int32_t returnBits;
-	returnBits = (status & 0x000000FF);
-	/*asm volatile("movl %%eax, %%esp 	\n\
-				  movl %%edx, %%eax     \n\
-				  movl %%ebx, %%ebp     \n\
-		"
-		:
-		: "a" (esp_old), "b"(ebp_old), "d" (returnBits)
-		);*/
+	tss.esp0 = control_block->parent_pcb->kernel_stack;
+
+	// Mark process as closed. Its stack is still in use until the switch below,
+	// but nothing can allocate it before then with interrupts off
+	process_free(halted_process);
+
 	asm volatile("movl %0, %%esp" :: "g"(esp_old));
 	asm volatile("movl %0, %%ebp" :: "g"(ebp_old));
-	asm volatile("pushl %0" :: "g"(returnBits));
-	asm volatile("popl %eax");
 	sti();
 	asm volatile("jmp halt_program");
 	return 0;
 }
 
 
+/* sys_fork
+ * DESCRIPTION: creates a copy of the calling process that runs alongside it. The child
+ *				shares the caller's program page copy on write, gets a copy of its
+ *				open files and registers, and returns from the same call with 0
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUES: the child's process number to the parent, 0 to the child, -1 if
+ *				  there is no process slot or memory left
+ * SIDE EFFECTS: the caller's writable pages become copy on write, the caller collects
+ *				 the child with sys_wait when it halts
+ */
+int32_t sys_fork(void)
+{
+	cli();
+	PCB_struct* parent;
+	PCB_struct* child;
+	uint32_t kernel_stack;
+	unsigned int* page_table;
+	uint32_t frame_bytes;
+	uint32_t resume;
+	uint32_t* stack;
+	int32_t process_num;
+	int32_t i;
+
+	parent = get_process_pcb(executing_process);
+
+	process_num = process_alloc();
+	if(process_num == -1)
+		return -1;
+
+	// the child is the parent with a number, stack and page table of its own
+	child = get_process_pcb(process_num);
+	kernel_stack = child->kernel_stack;
+	page_table = child->page_table;
+	memcpy(child, parent, sizeof(PCB_struct));
+	child->kernel_stack = kernel_stack;
+	child->page_table = page_table;
+	child->process_ID = process_num;
+	child->terminal_shell = 0;
+	child->parent_exists = 0;
+	child->child_exists = 0;
+	child->parent_pcb = parent;
+	child->child_pcb = NULL;
+	child->background = 1;
+	child->exited = 0;
+	child->child_wait.first = NULL;
+	child->child_wait.last = NULL;
+	child->child_wait.boost = 0;
+	syscall_stats_reset(process_num);
+
+	for(i = 0; i < 8; i++){
+
+		if(child->fd_array[i].flags != NOT_IN_USE)
+			pipe_share(&child->fd_array[i]);
+	}
+
+	program_map_fork(executing_process, process_num);
+
+	// the entry code recorded which frame it pushed
+	if(*(uint32_t*)parent->kernel_stack == SYSCALL_ENTRY_INT){
+
+		frame_bytes = SYSCALL_INT_FRAME;
+		resume = (uint32_t)fork_child_int;
+	}
+	else{
+
+		frame_bytes = SYSCALL_SYSENTER_FRAME;
+		resume = (uint32_t)fork_child_sysenter;
+	}
+
+	// the child leaves the call through a copy of the parent's entry frame
+	stack = (uint32_t*)(child->kernel_stack - frame_bytes);
+	memcpy(stack, (void*)(parent->kernel_stack - frame_bytes), frame_bytes);
+	child->curr_esp = initial_context(stack, resume);
+	add_runnable_task(process_num);
+
+	return process_num;
+}
+
+
+/* sys_wait
+ * DESCRIPTION: waits for a child made by fork or spawn to halt, and frees it
+ * INPUTS: pid - the child, or -1 for any of them
+ *		   status - where to store the value it halted with, NULL if not wanted
+ *		   flags - WAIT_NOHANG to return at once if no such child has halted yet
+ * OUTPUTS: writes status
+ * RETURN VALUES: the child's process number, 0 if WAIT_NOHANG was given and none has
+ *				  halted, -1 if the caller has no such child or status is bad
+ * SIDE EFFECTS: the caller is not scheduled while it waits
+ */
+int32_t sys_wait(int32_t pid, int32_t* status, int32_t flags)
+{
+	cli();
+	PCB_struct* control_block;
+	PCB_struct* child;
+	int32_t has_child;
+	int32_t code;
+	int32_t i;
+
+	if(status != NULL && bad_userspace_addr(status, sizeof(int32_t)))
+		return -1;
+
+	control_block = get_process_pcb(executing_process);
+	while(1){
+
+		has_child = 0;
+		for(i = 0; i < process_table_size; i++){
+
+			child = process_table[i];
+			if(child == NULL || child->background != 1 || child->parent_pcb != control_block)
+				continue;
+			if(pid != -1 && pid != i)
+				continue;
+
+			if(child->exited == 1){
+
+				code = child->exit_status;
+				process_free(i);
+				if(status != NULL && copy_to_user(status, &code, sizeof(int32_t)) == -1)
+					return -1;
+				return i;
+			}
+			has_child = 1;
+		}
+
+		if(has_child == 0)
+			return -1;
+		if(flags & WAIT_NOHANG)
+			return 0;
+
+		// a child halting wakes its parent
+		sleep_on(&control_block->child_wait);
+	}
+}
+
+
 /* sys_read
  * DESCRIPTION: reads data from the keyboard, a file, device (RTC), or directory
  * INPUTS: fd - file descriptor
@@ -356,7 +665,7 @@ int32_t sys_read(int32_t fd, void* buf, int32_t nbytes){
 	
 	// Check that the file directory exists, the buffer isn't null, and it's not stdout
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 	if(fd > 7 || fd < 0)
 		return -1;
 
@@ -382,7 +691,7 @@ int32_t sys_read(int32_t fd, void* buf, int32_t nbytes){
  */
 int32_t sys_write(int32_t fd, const void* buf, int32_t nbytes){
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 	if(fd > 7 || fd < 0)
 		return -1;
 	
@@ -395,6 +704,355 @@ int32_t sys_write(int32_t fd, const void* buf, int32_t nbytes){
 }
 
 
+/* sys_lseek
+ * DESCRIPTION: moves the position of an open regular file
+ * INPUTS: fd - file descriptor
+ *		   offset - bytes to move
+ *		   whence - SEEK_SET, SEEK_CUR or SEEK_END, what offset is relative to
+ * OUTPUTS: none
+ * RETURN VALUES: the new position, -1 for failure
+ * SIDE EFFECTS: later reads start from the new position
+ */
+int32_t sys_lseek(int32_t fd, int32_t offset, int32_t whence){
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+	if(fd > 7 || fd < 0)
+		return -1;
+
+	if((control_block->fd_array[fd].flags == NOT_IN_USE) || control_block->fd_array[fd].jtable != &file_jtable){
+
+		return -1;
+	}
+
+	return file_lseek(fd, offset, whence);
+}
+
+
+/* sys_pread
+ * DESCRIPTION: reads an open regular file at a given offset
+ * INPUTS: fd - file descriptor
+ *		   buf - buffer to be filled with bytes read
+ *		   nbytes - number of bytes to be read
+ *		   offset - where in the file to start
+ * OUTPUTS: puts the read data into buf
+ * RETURN VALUES: number of bytes read, 0 at or past the end of the file, -1 for failure
+ * SIDE EFFECTS: the file position is neither used nor moved
+ */
+int32_t sys_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset){
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+	if(fd > 7 || fd < 0)
+		return -1;
+
+	if((control_block->fd_array[fd].flags == NOT_IN_USE) || buf == NULL ||
+		control_block->fd_array[fd].jtable != &file_jtable){
+
+		return -1;
+	}
+
+	return file_pread(fd, (uint8_t*)buf, nbytes, offset);
+}
+
+
+/* sys_sendfile
+ * DESCRIPTION: writes the next count bytes of an open regular file to the terminal
+ *				without copying them through user space. Each run of the file's data
+ *				is handed to the terminal straight from the file system
+ * INPUTS: out_fd - file descriptor of the terminal
+ *		   in_fd - file descriptor of an open regular file
+ *		   count - most bytes to send
+ * OUTPUTS: the data is displayed on the screen
+ * RETURN VALUES: number of bytes sent, 0 at the end of the file, -1 for failure
+ * SIDE EFFECTS: moves the position of in_fd past the bytes sent
+ */
+int32_t sys_sendfile(int32_t out_fd, int32_t in_fd, int32_t count){
+	PCB_struct * control_block;
+	file_descriptor* in;
+	uint8_t* data;
+	int32_t chunk;
+	int32_t sent;
+	control_block = get_process_pcb(executing_process);
+	if(out_fd > 7 || out_fd < 0 || in_fd > 7 || in_fd < 0 || count < 0)
+		return -1;
+
+	if(control_block->fd_array[out_fd].flags == NOT_IN_USE || control_block->fd_array[in_fd].flags == NOT_IN_USE ||
+		control_block->fd_array[out_fd].jtable != &terminal_jtable || control_block->fd_array[in_fd].jtable != &file_jtable){
+
+		return -1;
+	}
+
+	in = &control_block->fd_array[in_fd];
+	sent = 0;
+	while(sent < count){
+
+		chunk = fs_data_run(in->inode_ptr, in->position, &data);
+		if(chunk == -1)
+			return (sent == 0) ? -1 : sent;
+		if(chunk == 0)
+			break;
+		if(chunk > count - sent)
+			chunk = count - sent;
+
+		terminal_output(data, chunk);
+
+		in->position += chunk;
+		sent += chunk;
+	}
+
+	return sent;
+}
+
+
+/* sys_ring_setup
+ * DESCRIPTION: registers the caller's submission ring, which must lie wholly in the
+ *				program page. The ring's heads and tails should start out equal
+ * INPUTS: ring - the ring, or NULL to stop using one
+ * OUTPUTS: none
+ * RETURN VALUES: 0 for success, -1 for failure
+ * SIDE EFFECTS: replaces any ring registered before
+ */
+int32_t sys_ring_setup(ring_t* ring){
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+
+	if(ring != NULL && bad_userspace_addr(ring, sizeof(ring_t))){
+
+		return -1;
+	}
+
+	control_block->ring = ring;
+	return 0;
+}
+
+
+/* ring_may_block
+ * DESCRIPTION: tells whether a queued operation can wait on a device or a pipe
+ * INPUTS: sqe - the operation
+ * OUTPUTS: none
+ * RETURN VALUES: 1 for a read of the terminal, the rtc or a pipe's read end, or a
+ *				  write to a pipe's write end, 0 otherwise
+ * SIDE EFFECTS: none
+ */
+static int32_t ring_may_block(const ring_sqe_t* sqe){
+	PCB_struct * control_block;
+	function_table* jtable;
+	control_block = get_process_pcb(executing_process);
+
+	if(sqe->fd > 7 || sqe->fd < 0 || control_block->fd_array[sqe->fd].flags == NOT_IN_USE)
+		return 0;
+	jtable = control_block->fd_array[sqe->fd].jtable;
+
+	if(sqe->opcode == RING_READ)
+		return (jtable == &terminal_jtable || jtable == &rtc_jtable || jtable == &pipe_reader_jtable);
+	if(sqe->opcode == RING_WRITE)
+		return (jtable == &pipe_writer_jtable);
+	return 0;
+}
+
+
+/* ring_drain
+ * DESCRIPTION: runs the executing process's queued operations in order, each through
+ *				the same system call the program would otherwise have made, and
+ *				posts one completion per operation. The ring is in user memory, so
+ *				it is only touched through copy_from_user and copy_to_user
+ * INPUTS: from_tick - 1 to stop at the first operation that may block
+ * OUTPUTS: fills in completions
+ * RETURN VALUES: number of operations completed
+ * SIDE EFFECTS: stops early if the completion queue is full or the ring is bad
+ */
+static int32_t ring_drain(int32_t from_tick){
+	PCB_struct * control_block;
+	ring_t* ring;
+	ring_sqe_t sqe;
+	ring_cqe_t cqe;
+	uint32_t index[4];	/* sq_head, sq_tail, cq_head, cq_tail */
+	int32_t result;
+	int32_t done;
+	control_block = get_process_pcb(executing_process);
+
+	ring = control_block->ring;
+	if(ring == NULL)
+		return 0;
+
+	done = 0;
+	while(copy_from_user(index, (void*)&ring->sq_head, sizeof(index)) == 0 &&
+		index[0] != index[1] && index[3] - index[2] < RING_ENTRIES){
+
+		if(copy_from_user(&sqe, &ring->sq[index[0] % RING_ENTRIES], sizeof(sqe)) == -1)
+			break;
+		if(from_tick && ring_may_block(&sqe))
+			break;
+
+		switch(sqe.opcode){
+			case RING_READ:
+				result = sys_read(sqe.fd, (void*)sqe.addr, sqe.len);
+				break;
+			case RING_WRITE:
+				result = sys_write(sqe.fd, (const void*)sqe.addr, sqe.len);
+				break;
+			case RING_OPEN:
+				result = sys_open((const uint8_t*)sqe.addr);
+				break;
+			case RING_CLOSE:
+				result = sys_close(sqe.fd);
+				break;
+			default:
+				result = -1;
+				break;
+		}
+
+		cqe.user_data = sqe.user_data;
+		cqe.result = result;
+		if(copy_to_user(&ring->cq[index[3] % RING_ENTRIES], &cqe, sizeof(cqe)) == -1)
+			break;
+
+		index[3]++;
+		index[0]++;
+		if(copy_to_user((void*)&ring->cq_tail, &index[3], sizeof(uint32_t)) == -1 ||
+			copy_to_user((void*)&ring->sq_head, &index[0], sizeof(uint32_t)) == -1)
+			break;
+		done++;
+	}
+
+	return done;
+}
+
+
+/* sys_ring_enter
+ * DESCRIPTION: runs every operation queued on the caller's ring, so a batch costs one
+ *				trap into the kernel
+ * INPUTS: none
+ * OUTPUTS: fills in completions
+ * RETURN VALUES: number of operations completed, -1 if no ring is registered
+ * SIDE EFFECTS: operations left when the completion queue fills stay queued
+ */
+int32_t sys_ring_enter(void){
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+
+	if(control_block->ring == NULL)
+		return -1;
+
+	return ring_drain(0);
+}
+
+
+/* ring_poll
+ * DESCRIPTION: called from the PIT handler when it interrupted user code. Drains the
+ *				executing process's ring if it asked for RING_POLL, up to the first
+ *				operation that may block
+ * INPUTS: none
+ * OUTPUTS: fills in completions
+ * RETURN VALUES: none
+ * SIDE EFFECTS: none
+ */
+void ring_poll(void){
+	PCB_struct * control_block;
+	uint32_t flags;
+	control_block = get_process_pcb(executing_process);
+
+	if(control_block->ring == NULL ||
+		copy_from_user(&flags, &control_block->ring->flags, sizeof(flags)) == -1)
+		return;
+
+	if(flags & RING_POLL)
+		ring_drain(1);
+}
+
+
+/* sys_readv
+ * DESCRIPTION: reads into several buffers in turn with one system call
+ * INPUTS: fd - file descriptor
+ *		   iov - array of buffers to fill, in order
+ *		   iovcnt - number of buffers in iov, at most MAX_IOV
+ * OUTPUTS: puts the read data into the buffers
+ * RETURN VALUES: total number of bytes read, 0 for eof, -1 for failure
+ * SIDE EFFECTS: stops at the first buffer that is not filled completely
+ */
+int32_t sys_readv(int32_t fd, const iovec_t* user_iov, int32_t iovcnt){
+	PCB_struct * control_block;
+	iovec_t iov[MAX_IOV];
+	int32_t i;
+	int32_t ret;
+	int32_t total;
+	control_block = get_process_pcb(executing_process);
+	if(fd > 7 || fd < 0)
+		return -1;
+
+	if((control_block->fd_array[fd].flags == NOT_IN_USE) || fd == 1 ||
+		iovcnt < 0 || iovcnt > MAX_IOV){
+
+		return -1;
+	}
+
+	if(copy_from_user(iov, user_iov, iovcnt * sizeof(iovec_t)) == -1)
+		return -1;
+
+	for(i = 0; i < iovcnt; i++){
+
+		if(iov[i].base == NULL || iov[i].len < 0)
+			return -1;
+	}
+
+	total = 0;
+	for(i = 0; i < iovcnt; i++){
+
+		ret = control_block->fd_array[fd].jtable->read(fd, (uint8_t*)iov[i].base, iov[i].len);
+		if(ret == -1)
+			return (total == 0) ? -1 : total;
+
+		total += ret;
+		if(ret < iov[i].len)
+			break;
+	}
+
+	return total;
+}
+
+
+/* sys_writev
+ * DESCRIPTION: writes several buffers in turn with one system call
+ * INPUTS: fd - file descriptor
+ *		   iov - array of buffers to write, in order
+ *		   iovcnt - number of buffers in iov, at most MAX_IOV
+ * OUTPUTS: none
+ * RETURN VALUES: 0 for success, -1 for failure
+ * SIDE EFFECTS: same as sys_write for each buffer
+ */
+int32_t sys_writev(int32_t fd, const iovec_t* user_iov, int32_t iovcnt){
+	PCB_struct * control_block;
+	iovec_t iov[MAX_IOV];
+	int32_t i;
+	control_block = get_process_pcb(executing_process);
+	if(fd > 7 || fd < 0)
+		return -1;
+
+	if((control_block->fd_array[fd].flags == NOT_IN_USE) || fd == 0 ||
+		iovcnt < 0 || iovcnt > MAX_IOV){
+
+		return -1;
+	}
+
+	if(copy_from_user(iov, user_iov, iovcnt * sizeof(iovec_t)) == -1)
+		return -1;
+
+	/* check every buffer first so a bad one does not leave a partial write */
+	for(i = 0; i < iovcnt; i++){
+
+		if(iov[i].base == NULL || iov[i].len < 0 || bad_userspace_addr(iov[i].base, iov[i].len))
+			return -1;
+	}
+
+	for(i = 0; i < iovcnt; i++){
+
+		if(control_block->fd_array[fd].jtable->write(fd, iov[i].base, iov[i].len) == -1)
+			return -1;
+	}
+
+	return 0;
+}
+
+
 /* sys_open
  * DESCRIPTION: provides access to the file system
  * INPUTS: filename - name of file to get access to
@@ -405,21 +1063,23 @@ int32_t sys_write(int32_t fd, const void* buf, int32_t nbytes){
  */
 int32_t sys_open(const uint8_t* filename){
 
+	uint8_t name[FNAMESIZE + 1];
 	dentry_t temp_dentry;
 	int i;
 	int32_t file_type;
 	int32_t name_length;
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 	
 
-	if(filename == NULL){
+	// names longer than FNAMESIZE can not be in the file system
+	if(safe_strncpy((int8_t*)name, (const int8_t*)filename, FNAMESIZE + 1) == -1){
 
 		return -1;
 	}
 
 
-	if(read_dentry_by_name(filename,&temp_dentry) == -1){
+	if(read_dentry_by_name(name,&temp_dentry) == -1){
 
 		return -1;
 		}
@@ -458,6 +1118,14 @@ int32_t sys_open(const uint8_t* filename){
 				control_block->fd_array[i].position = 0;
 				return i;
 			}
+			// file type is the system call statistics
+			else if(temp_dentry.f_type == STATS_FILE){
+
+				control_block->fd_array[i].jtable = &(stats_jtable);
+				control_block->fd_array[i].flags = IN_USE;
+				control_block->fd_array[i].position = 0;
+				return i;
+			}
 		}
 	}
 
@@ -476,11 +1144,7 @@ int32_t sys_open(const uint8_t* filename){
  */
 int32_t sys_close(int32_t fd){
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
-	if(control_block->fd_array[fd].flags == NOT_IN_USE){
-
-		return -1;
-	}
+	control_block = get_process_pcb(executing_process);
 	if(fd > 7 || fd < 2)
 		return -1;
 	if(control_block->fd_array[fd].flags == NOT_IN_USE){
@@ -488,12 +1152,28 @@ int32_t sys_close(int32_t fd){
 		return -1;
 	}
 
-	control_block->fd_array[fd].flags = NOT_IN_USE;
+	close_fd(control_block, fd);
 
 	return 0;
 }
 
 
+/* close_fd
+ * DESCRIPTION: lets the file's type know an fd of the executing process is going
+ *				away, then marks it free
+ * INPUTS: control_block - the executing process
+ *		   fd - fd in use, stdin and stdout included
+ * OUTPUTS: none
+ * RETURN VALUES: none
+ * SIDE EFFECTS: the last fd on a pipe frees it
+ */
+static void close_fd(PCB_struct* control_block, int32_t fd){
+
+	control_block->fd_array[fd].jtable->close(fd);
+	control_block->fd_array[fd].flags = NOT_IN_USE;
+}
+
+
 /* sys_getargs
  * DESCRIPTION: reads the program’s command line arguments into a user-level buffer
  * INPUTS: buf: program's command line buffer
@@ -505,21 +1185,15 @@ int32_t sys_close(int32_t fd){
 int32_t sys_getargs (uint8_t* buf, int32_t nbytes){
 	int arg_length;
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 
 	arg_length = strlen((int8_t*)control_block->args);
 
-	if(buf == NULL){
-
-		return -1;
-	}
-	
-	if(arg_length > nbytes)		//if args don't fit in buffer, return -1
+	if(arg_length >= nbytes)		//if args and their '\0' don't fit in buffer, return -1
 		return -1;
 	
 
-	strcpy((int8_t*)buf, (int8_t*)control_block->args);
-	return 0;
+	return copy_to_user(buf, control_block->args, arg_length + 1);
 }
 
 
@@ -533,33 +1207,76 @@ int32_t sys_getargs (uint8_t* buf, int32_t nbytes){
 int32_t sys_vidmap (uint8_t ** screen_start){
 
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8*(executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
 
-	if((uint32_t)screen_start < _128MB || (uint32_t)screen_start > _132MB){
-
-		return -1;
-	}
+	uint8_t* video;
 
 	switch(get_active_terminal()){
 
 		case 0:
-			*screen_start = (uint8_t*)VIDEO1;
+			video = (uint8_t*)VIDEO1;
 			break;
 			
 		case 1:
-			*screen_start = (uint8_t*)VIDEO2;
+			video = (uint8_t*)VIDEO2;
 			break; 
 			
 		case 2: 
-			*screen_start = (uint8_t*)VIDEO3;
+			video = (uint8_t*)VIDEO3;
 			break;
 			
 		default:
-			break;
+			return -1;
 	}
 
-	return 0;
+	return copy_to_user(screen_start, &video, sizeof(uint8_t*));
+
+}
+
+
+/* sys_mmap
+ * DESCRIPTION: maps an open regular file read only into the program page, so its
+ *				contents can be read in place instead of copied out with read
+ * INPUTS: fd - file descriptor of an open regular file
+ *		   start - location provided by the caller to receive the mapping's address
+ * OUTPUTS: *start is set to the first byte of the file
+ * RETURN VALUES: length of the file in bytes, -1 for failure
+ * SIDE EFFECTS: uses up the mmap part of the program page until the process halts
+ */
+int32_t sys_mmap (int32_t fd, uint8_t** start){
+
+	PCB_struct * control_block;
+	int32_t length;
+	int32_t mapped;
+	uint32_t size;
+	control_block = get_process_pcb(executing_process);
+
+	if(fd > 7 || fd < 0)
+		return -1;
+
+	if(control_block->fd_array[fd].flags == NOT_IN_USE || control_block->fd_array[fd].jtable != &file_jtable){
+
+		return -1;
+	}
+
+	length = fs_file_length(control_block->fd_array[fd].inode_ptr);
+	if(length == -1)
+		return -1;
+
+	size = (length + KB_ALIGN - 1) & ~(KB_ALIGN - 1);
+	if(size > MMAP_END - control_block->mmap_end)
+		return -1;
+
+	if(copy_to_user(start, &control_block->mmap_end, sizeof(uint8_t*)) == -1)
+		return -1;
 
+	// pages mapped before memory ran out stay until the process halts
+	mapped = program_map_file(control_block->fd_array[fd].inode_ptr, length, control_block->mmap_end);
+	control_block->mmap_end += size;
+	if(mapped == -1)
+		return -1;
+
+	return length;
 }
 
 
@@ -588,17 +1305,40 @@ int32_t sys_sigreturn (void){
 }
 
 
+/* sys_getdents
+ * DESCRIPTION: reads a batch of directory entries in one call
+ * INPUTS: fd - file descriptor of an open directory
+ *		   buf - buffer to be filled with packed dirent_t records
+ *		   nbytes - size of buf
+ * OUTPUTS: puts the records into buf
+ * RETURN VALUES: number of bytes of records, 0 at the end of the directory, -1 for failure
+ * SIDE EFFECTS: advances the directory position
+ */
+int32_t sys_getdents (int32_t fd, void* buf, int32_t nbytes){
+	PCB_struct * control_block;
+	control_block = get_process_pcb(executing_process);
+	if(fd > 7 || fd < 0)
+		return -1;
+
+	if((control_block->fd_array[fd].flags == NOT_IN_USE) || buf == NULL || nbytes < 0 ||
+		control_block->fd_array[fd].jtable != &directory_jtable){
+
+		return -1;
+	}
+
+	return dir_getdents(fd, (uint8_t*)buf, nbytes);
+}
+
+
 /* stdin
  * DESCRIPTION: opens terminal read
- * INPUTS: none
+ * INPUTS: control_block - process to give a keyboard
  * OUTPUTS: none
  * RETURN VALUES: none
  * SIDE EFFECTS: none
  */
-void stdin()
+void stdin(PCB_struct * control_block)
 {	
-	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
 	control_block->fd_array[0].flags = IN_USE;
 	control_block->fd_array[0].jtable = &(terminal_jtable);
 
@@ -607,15 +1347,13 @@ void stdin()
 
 /* stdout
  * DESCRIPTION: opens terminal write
- * INPUTS: none
+ * INPUTS: control_block - process to give a screen
  * OUTPUTS: none
  * RETURN VALUES: none
  * SIDE EFFECTS: none
  */
-void stdout()
+void stdout(PCB_struct * control_block)
 {
-	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
 	control_block->fd_array[1].flags = IN_USE;
 	control_block->fd_array[1].jtable = &(terminal_jtable);
 }
@@ -629,7 +1367,7 @@ void stdout()
  * SIDE EFFECTS: starts the initial shell
  */
 void boot(){
-sys_execute((uint8_t*)"shell terminal");
+kernel_execute((uint8_t*)"shell terminal");
 }
 
 
@@ -637,15 +1375,145 @@ sys_execute((uint8_t*)"shell terminal");
  * DESCRIPTION: return a process's PCB
  * INPUTS: process: process who's PCB is required
  * OUTPUTS: none
- * RETURN VALUES: pointer to PCB struct for the process
+ * RETURN VALUES: pointer to PCB struct for the process, NULL if there is no such process
  * SIDE EFFECTS: none
  */
 PCB_struct * get_process_pcb(int32_t process){
 
-	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (process + 2)));
+	if(process < 0 || process >= process_table_size)
+		return NULL;
+
+	return process_table[process];
+}
+
+
+/* process_alloc
+ * DESCRIPTION: takes the lowest free process number, doubling the process table when
+ *				it is full, and gives the process a kernel stack with its PCB at the
+ *				bottom and a page table for its program page
+ * INPUTS: none
+ * OUTPUTS: none
+ * RETURN VALUES: the process number, -1 if MAX_PROCESSES are running or memory ran out
+ * SIDE EFFECTS: the PCB is not initialized beyond kernel_stack and page_table,
+ *				 background processes that halted with no parent to collect them
+ *				 are freed first
+ */
+static int32_t process_alloc(void){
+
+	PCB_struct** table;
+	PCB_struct* control_block;
+	int32_t size;
+	int32_t i;
+
+	// they are off their stacks by now
+	for(i = 0; i < process_table_size; i++){
+
+		if(process_table[i] != NULL && process_table[i]->exited == 1 && process_table[i]->parent_pcb == NULL)
+			process_free(i);
+	}
+
+	for(i = 0; i < process_table_size; i++){
+
+		if(process_table[i] == NULL)
+			break;
+	}
+
+	if(i == process_table_size){
+
+		size = (process_table_size == 0) ? PROCESS_TABLE_START : process_table_size * 2;
+		if(size > MAX_PROCESSES)
+			return -1;
+
+		table = frames_realloc(process_table, process_table_size * sizeof(PCB_struct*), size * sizeof(PCB_struct*));
+		if(table == NULL)
+			return -1;
+
+		process_table = table;
+		process_table_size = size;
+	}
+
+	control_block = (PCB_struct*)frames_alloc(KB8 / FRAME_SIZE);
+	if(control_block == NULL)
+		return -1;
+
+	control_block->page_table = (unsigned int*)frames_alloc(1);
+	if(control_block->page_table == NULL){
+
+		frames_free((uint32_t)control_block, KB8 / FRAME_SIZE);
+		return -1;
+	}
+
+	control_block->kernel_stack = (uint32_t)control_block + KB8 - 4;
+	process_table[i] = control_block;
+	return i;
+}
+
+
+/* initial_context
+ * DESCRIPTION: finishes the kernel stack of a process that has not run yet, so that
+ *				switching to it with switch_context starts it at resume. Anything
+ *				resume takes off the stack must already be on it
+ * INPUTS: stack - lowest word in use at the top of the process's kernel stack
+ *		   resume - where switch_context returns to
+ * OUTPUTS: writes the stack
+ * RETURN VALUES: the stack pointer to switch to
+ * SIDE EFFECTS: none
+ */
+uint32_t initial_context(uint32_t* stack, uint32_t resume){
+
+	int i;
 
-	return control_block;
+	*--stack = resume;
+	for(i = 0; i < SWITCH_REGS; i++)
+		*--stack = 0;
+
+	return (uint32_t)stack;
+}
+
+
+/* orphan_children
+ * DESCRIPTION: lets go of a halting process's background children. Those that have
+ *				halted are freed, the rest are left for process_alloc to free when
+ *				they halt
+ * INPUTS: parent - the halting process
+ * OUTPUTS: none
+ * RETURN VALUES: none
+ * SIDE EFFECTS: none
+ */
+static void orphan_children(PCB_struct* parent){
+
+	int32_t i;
+
+	for(i = 0; i < process_table_size; i++){
+
+		if(process_table[i] == NULL || process_table[i]->background != 1 || process_table[i]->parent_pcb != parent)
+			continue;
+
+		process_table[i]->parent_pcb = NULL;
+		if(process_table[i]->exited == 1)
+			process_free(i);
+	}
+}
+
+
+/* process_free
+ * DESCRIPTION: gives back a process's number, kernel stack and page table
+ * INPUTS: process_num - process from process_alloc
+ * OUTPUTS: none
+ * RETURN VALUES: none
+ * SIDE EFFECTS: its program pages must already be freed with program_map_free
+ */
+static void process_free(int32_t process_num){
+
+	PCB_struct* control_block;
+
+	control_block = get_process_pcb(process_num);
+	if(control_block == NULL)
+		return;
+
+	process_table[process_num] = NULL;
+	frames_free((uint32_t)control_block->page_table, 1);
+	frames_free((uint32_t)control_block, KB8 / FRAME_SIZE);
 }
 
 
@@ -685,7 +1553,11 @@ void set_executing_process(uint32_t new_process){
 int32_t get_process_terminal(){
 
 	PCB_struct * control_block;
-	control_block = (PCB_struct*)((KERNEL_MEM_BOTTOM) - (KB8 * (executing_process + 2)));
+	control_block = get_process_pcb(executing_process);
+
+	// the first terminal until a process runs
+	if(control_block == NULL)
+		return 0;
 
 	return control_block->terminal;
 }
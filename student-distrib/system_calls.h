@@ -9,17 +9,30 @@
 #include "types.h"
 #include "lib.h"
 #include "rtc.h"
+#include "wait_queue.h"
  
 volatile int32_t executing_process;
 #define VIDEO 0xB8000
-#define KERNEL_MEM_BOTTOM 0x800000
 #define NOT_IN_USE 0
 #define IMAGE_MEM 0x08048000
 #define _128MB 0x08000000
 #define _132MB 0x08400000
-#define KB8 0x8000
+#define KB8 0x2000	/* size of a kernel stack, the PCB sits at its bottom */
 #define KB4_Shift 12
 #define IN_USE 1
+#define MAX_IOV 16	/* most buffers a single readv or writev may name */
+#define RING_ENTRIES 32	/* slots in each queue of a submission ring, a power of two */
+#define RING_POLL 0x1	/* ring flag, also drain the ring on PIT ticks */
+#define RING_READ 1		/* ring operations */
+#define RING_WRITE 2
+#define RING_OPEN 3
+#define RING_CLOSE 4
+#define COMMAND_SIZE 256	/* longest command sys_execute copies in, '\0' included */
+#define PROCESS_TABLE_START 8	/* slots in the process table before it first grows */
+#define MAX_PROCESSES 1024	/* the process table doubles up to this many slots */
+#define WAIT_NOHANG 0x1	/* sys_wait flag, return 0 instead of blocking */
+#define HALT_EXCEPTION 256	/* status execute and sys_wait give a process an exception killed */
+#define DEMAND_PAGED_EXEC 1	/* 1 to fill program pages on first touch, 0 to copy the whole image at execute */
 
 
 
@@ -33,6 +46,46 @@ typedef struct function_table{
 }function_table;
 
 
+/* One buffer of a readv or writev request */
+typedef struct iovec_t{
+
+	void* base;
+	int32_t len;
+}iovec_t;
+
+
+/* One queued operation. addr is the buffer, or the file name for RING_OPEN */
+typedef struct ring_sqe_t{
+
+	uint32_t opcode;
+	int32_t fd;
+	uint32_t addr;
+	int32_t len;
+	uint32_t user_data;	/* handed back untouched in the completion */
+}ring_sqe_t;
+
+/* The result of one operation, what the matching system call would have returned */
+typedef struct ring_cqe_t{
+
+	uint32_t user_data;
+	int32_t result;
+}ring_cqe_t;
+
+/* Submission and completion queues shared between a process and the kernel. The
+   program fills sq and advances sq_tail, the kernel consumes up to sq_tail and
+   advances cq_tail; heads and tails only ever grow and index modulo RING_ENTRIES */
+typedef struct ring_t{
+
+	volatile uint32_t sq_head;	/* written by the kernel */
+	volatile uint32_t sq_tail;	/* written by the program */
+	volatile uint32_t cq_head;	/* written by the program */
+	volatile uint32_t cq_tail;	/* written by the kernel */
+	uint32_t flags;
+	ring_sqe_t sq[RING_ENTRIES];
+	ring_cqe_t cq[RING_ENTRIES];
+}ring_t;
+
+
 typedef struct file_descriptor{
 
 	function_table* jtable;
@@ -42,6 +95,11 @@ typedef struct file_descriptor{
 } file_descriptor;
 
 
+#define TASK_RUNNING 0	/* has the processor */
+#define TASK_RUNNABLE 1	/* on a run queue, waiting for the processor */
+#define TASK_BLOCKED 2	/* asleep on a wait_queue_t, or in execute until its child halts */
+#define TASK_DEAD 3	/* halted */
+
 /*PCB structure keeps track of its parent, children, 
 process number, associated file descriptor array, what terminal
 it is associated with, and previous values of esp and ebp used for task
@@ -56,13 +114,28 @@ typedef struct PCB_struct{
 	uint32_t parent_exists;
 	uint32_t child_exists;
 	uint32_t terminal_shell;
+	uint32_t background;	/* 1 if made by fork or spawn, nobody waits in execute for it to halt */
+	uint32_t exited;	/* 1 once a background process has halted, until it is collected */
+	int32_t exit_status;	/* what it halted with, for sys_wait */
+	int32_t child_status;	/* what the child it ran with execute halted with */
+	struct PCB_struct* wait_next;	/* next sleeper on the wait_queue_t it sleeps on */
+	wait_queue_t child_wait;	/* where it sleeps in sys_wait until a child halts */
+	uint32_t level;		/* MLFQ level, see scheduler */
+	uint32_t nice;		/* highest level it may reach, set by sys_nice */
+	uint32_t boost_epoch;	/* last boost it was given its top level for */
+	uint32_t state;		/* TASK_RUNNING and so on */
+	struct PCB_struct* run_next;	/* next task on the same run queue */
 
 	uint32_t old_esp;
 	uint32_t old_ebp;
 	uint32_t curr_esp;
 	uint32_t curr_ebp;
-	uint32_t kernel_stack;
+	uint32_t kernel_stack;	/* tss.esp0 while the process runs */
 	uint32_t terminal;
+	exec_info_t exe;	/* program image, used to fill demand paged pages and restart shells */
+	unsigned int* page_table;	/* the process's page table for the program page */
+	uint32_t mmap_end;	/* where the next mmap goes, MMAP_START if nothing is mapped */
+	ring_t* ring;		/* registered submission ring, NULL if none */
 	struct PCB_struct* parent_pcb;
 	struct PCB_struct* child_pcb;
 }PCB_struct;
@@ -75,8 +148,20 @@ volatile PCB_struct* executing_control_block;
 
 int32_t sys_execute(const uint8_t * command);
 
+int32_t kernel_execute(const uint8_t * command);
+
 int32_t sys_halt(uint8_t status);
 
+int32_t halt_process(uint32_t status);
+
+int32_t sys_fork(void);
+
+int32_t sys_spawn(const uint8_t * command, int32_t in_fd, int32_t out_fd);
+
+int32_t sys_pipe(int32_t* fds);
+
+int32_t sys_wait(int32_t pid, int32_t* status, int32_t flags);
+
 int32_t sys_read(int32_t fd, void* buf, int32_t nbytes);
 
 
@@ -94,9 +179,29 @@ int32_t sys_set_handler (int32_t signum, void* handler_address);
 
 int32_t sys_sigreturn (void);
 
-void stdin();
+int32_t sys_getdents (int32_t fd, void* buf, int32_t nbytes);
+
+int32_t sys_readv(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+int32_t sys_writev(int32_t fd, const iovec_t* iov, int32_t iovcnt);
+
+int32_t sys_mmap(int32_t fd, uint8_t** start);
+
+int32_t sys_lseek(int32_t fd, int32_t offset, int32_t whence);
 
-void stdout();
+int32_t sys_pread(int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+
+int32_t sys_sendfile(int32_t out_fd, int32_t in_fd, int32_t count);
+
+int32_t sys_ring_setup(ring_t* ring);
+
+int32_t sys_ring_enter(void);
+
+void ring_poll(void);
+
+void stdin(PCB_struct * control_block);
+
+void stdout(PCB_struct * control_block);
 
 void allocate_video(int32_t task);
 
@@ -110,6 +215,8 @@ uint32_t get_executing_process();
 
 int32_t get_process_terminal();
 
+uint32_t initial_context(uint32_t* stack, uint32_t resume);
+
 
 
 
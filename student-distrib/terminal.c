@@ -62,67 +62,100 @@ int32_t terminal_close(int32_t fd)
  * INPUTS: fd - file descriptor index (not used)
  *		   buf - destination address
  *		   nbytes - number of bytes to be read
- * OUTPUTS: writes text to memory at location [buf]
- * SIDE EFFECTS: none
- * RETURN VALUE: number of bytes written 
+ * OUTPUTS: writes the line, ending in '\n', to memory at location [buf]. A line
+ *			longer than nbytes is cut short to fit
+ * SIDE EFFECTS: the process is not scheduled until enter is pressed
+ * RETURN VALUE: number of bytes written, -1 if buf is bad
  */
 int32_t terminal_read (int32_t fd, uint8_t* buf, int32_t nbytes)
 {
-	asm("sti");
+	uint8_t line[SIZE_OF_BUFFER];
+	int32_t ret;
+
+	if (nbytes <= 0)
+		return -1;
+
 	int buflen=0;
-	while(terminals[get_process_terminal()].allow_read == 0);
 	asm("cli");
+	while(terminals[get_process_terminal()].allow_read == 0)
+		sleep_on(&terminals[get_process_terminal()].read_wait);
 	buflen = strlen((int8_t*)terminals[active_terminal].keyboard_buffer);
 	
-	memcpy((void*)buf, (void*)terminals[active_terminal].keyboard_buffer, SIZE_OF_BUFFER);
 	if (buflen >= SIZE_OF_BUFFER)
 		buflen = SIZE_OF_BUFFER-1;
-	buf[buflen] = '\n';
+	if (buflen >= nbytes)
+		buflen = nbytes-1;
+	memcpy((void*)line, (void*)terminals[active_terminal].keyboard_buffer, buflen);
+	line[buflen] = '\n';
 	buflen++;
 	
 	terminals[active_terminal].allow_read = 0;
+	ret = copy_to_user(buf, line, buflen);
 	asm("sti");
 	
-	return buflen;
+	return (ret == -1) ? -1 : buflen;
 }
 
 /* terminal_write function, writes data to the terminal
- * DESCRIPTION: writes data from buffer into terminal's screen
+ * DESCRIPTION: writes data from a user buffer into terminal's screen, copying it
+ *				in a piece at a time
  * INPUTS: fd - file descriptor (not used)
  *		   buf - pointer to start of buffer to copy from
  *		   nbytes - number of bytes to be copied
  * OUTPUTS: displays text to screen of the current terminal
  * RETURN VALUE: 0 - success; -1 - failure
- * SIDE EFFECTS: none
+ * SIDE EFFECTS: text before a bad part of buf is still displayed
  */
 int32_t terminal_write (int32_t fd, const void* buf, int32_t nbytes)
 {
-	int i;
-	int length;
-	uint8_t* temp;
-
-	asm("cli"); // Do not allow interrupts
+	uint8_t piece[SIZE_OF_BUFFER];
+	int32_t done;
+	int32_t len;
 
 	// don't try to write an empty buffer
-	if(buf == NULL){
+	if(buf == NULL || bad_userspace_addr(buf, nbytes))
 		return -1;
+
+	for(done = 0; done < nbytes; done += len){
+		len = nbytes - done;
+		if(len > SIZE_OF_BUFFER)
+			len = SIZE_OF_BUFFER;
+		if(copy_from_user(piece, (const uint8_t*)buf + done, len) == -1)
+			return -1;
+		terminal_output(piece, len);
 	}
+
+	return 0;
+}
+
+/* terminal_output
+ * DESCRIPTION: writes kernel data into terminal's screen
+ * INPUTS: data - pointer to start of the data
+ *		   nbytes - number of bytes to be written
+ * OUTPUTS: displays text to screen of the current terminal
+ * RETURN VALUE: none
+ * SIDE EFFECTS: interrupts are off while it writes, and stay off afterwards if
+ *				they were off before, as in a polled ring write from the PIT handler
+ */
+void terminal_output (const uint8_t* data, int32_t nbytes)
+{
+	int i;
+	uint32_t flags;
+
+	cli_and_save(flags); // Do not allow interrupts
+
 	int t;
 	t = get_process_terminal();
 	if(terminals[t].screen_y >= 24)
   		scroll();
-	temp = (uint8_t*)buf;
-	length = strlen((int8_t*)temp);
-	for(i = 0; i < SIZE_OF_BUFFER && i < nbytes; i++){
-		putc(temp[i]);
+	for(i = 0; i < nbytes; i++){
+		putc(data[i]);
 	}
 
 	/*if(strncmp("391OS", (int8_t*)buf, 5) == 0)
 		update_cursor(0);*/
 
-    asm("sti");
-
-	return 0;
+	restore_flags(flags);
 }
 
 /* terminal_clear
@@ -6,6 +6,7 @@
 #define _TERMINAL_H
 
 #include "types.h"
+#include "wait_queue.h"
 
 #define SIZE_OF_BUFFER 128
 
@@ -25,6 +26,7 @@ typedef struct terminal_t{
 	int32_t buf_idx;
 	uint32_t shell_exists;
 	uint32_t allow_read;
+	wait_queue_t read_wait;	/* processes in terminal_read until a line is entered */
 } terminal_t;
 
 extern terminal_t terminals[3];
@@ -34,6 +36,7 @@ int32_t terminal_open(const uint8_t* filename);
 int32_t terminal_close(int32_t fd);
 int32_t terminal_read (int32_t fd, uint8_t* buf, int32_t nbytes);
 int32_t terminal_write (int32_t fd, const void* buf, int32_t nbytes);
+void terminal_output (const uint8_t* data, int32_t nbytes);
 void terminal_clear();
 
 // update the cursor position
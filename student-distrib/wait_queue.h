@@ -0,0 +1,29 @@
+/* wait_queue.h - processes blocked until something happens
+ * vim:ts=4 noexpandtab
+ */
+
+#ifndef _WAIT_QUEUE_H
+#define _WAIT_QUEUE_H
+
+#include "types.h"
+
+struct PCB_struct;
+
+/* Sleepers in the order they went to sleep, linked through their PCBs. A
+   sleeping process is on no run queue, so the scheduler never looks at it until
+   wake_up puts it back. A zeroed queue is empty */
+typedef struct wait_queue_t{
+
+	struct PCB_struct* first;
+	struct PCB_struct* last;
+	uint32_t boost;	/* 1 if sleepers wake at their top MLFQ level, for interactive input */
+}wait_queue_t;
+
+/* Externally-visible functions, in scheduling.c */
+
+/* Blocks the executing process on queue, called with interrupts off */
+void sleep_on(wait_queue_t* queue);
+/* Makes every process on queue runnable again, safe in interrupt handlers */
+void wake_up(wait_queue_t* queue);
+
+#endif /* _WAIT_QUEUE_H */
@@ -7,7 +7,7 @@
 
 int main ()
 {
-    uint32_t i, cnt, max = 0;
+    uint32_t i, cnt, max = 0, start;
     uint8_t buf[BUFSIZE];
 
     ece391_fdputs(1, (uint8_t*)"Enter the Test Number: (0): 100, (1): 10000, (2): 100000\n");
@@ -34,12 +34,19 @@ int main ()
         }
     }
 
+    start = ece391_pit_ticks();
     for (i = 0; i < max; i++) {
         ece391_itoa(i+1, buf, 10);
         ece391_fdputs(1, buf);
         ece391_fdputs(1, (uint8_t*)"\n");
     }
 
+    /* read straight from the kernel data page, no system call */
+    ece391_fdputs(1, (uint8_t*)"took ");
+    ece391_fdputs(1, ece391_itoa((ece391_pit_ticks() - start) * 1000 /
+                                 ECE391_KERNEL_DATA->pit_hz, buf, 10));
+    ece391_fdputs(1, (uint8_t*)" ms\n");
+
     return 0;
 }
 
@@ -0,0 +1,63 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define SECONDS 2
+#define GAP_US 100		/* a longer gap between two reads of the counter was spent elsewhere */
+#define GUESS_KHZ 1000000	/* if the kernel could not measure the counter */
+#define BUFSIZE 16
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+/* cpushare - spins for a few seconds and reports how much of that time it was
+   given the processor.  Run it with the other terminals sitting at a prompt to
+   see what their shells cost, and with TICKLESS on and off in the kernel to
+   see what the timer interrupts do */
+int main ()
+{
+    uint32_t khz, gap, now, last, took, elapsed, away, ms, away_ms, lost, irqs;
+    uint8_t buf[BUFSIZE];
+
+    khz = ECE391_KERNEL_DATA->tsc_khz;
+    if (0 == khz)
+        khz = GUESS_KHZ;
+    gap = khz / 1000 * GAP_US;
+
+    /* whole milliseconds are carried out of the cycle counts so nothing overflows */
+    elapsed = away = ms = away_ms = lost = 0;
+    irqs = ECE391_KERNEL_DATA->timer_irqs;
+    last = rdtsc ();
+    while (ms < SECONDS * 1000) {
+        now = rdtsc ();
+        took = now - last;
+        last = now;
+        if (took > gap) {
+            away += took;
+            lost++;
+        }
+        for (elapsed += took; elapsed >= khz; elapsed -= khz)
+            ms++;
+        for (; away >= khz; away -= khz)
+            away_ms++;
+    }
+    irqs = ECE391_KERNEL_DATA->timer_irqs - irqs;
+
+    ece391_fdputs (1, (uint8_t*)"ran ");
+    ece391_fdputs (1, ece391_itoa (100 - away_ms / (SECONDS * 10), buf, 10));
+    ece391_fdputs (1, (uint8_t*)"% of ");
+    ece391_fdputs (1, ece391_itoa (SECONDS, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"s, descheduled ");
+    ece391_fdputs (1, ece391_itoa (lost, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" times, ");
+    ece391_fdputs (1, ece391_itoa (irqs, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" timer interrupts\n");
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define PRESSES 5
+#define HOG_SECONDS 30
+#define MAX_HOGS 9
+#define BUFSIZE 64
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+
+void
+report (const char* name, uint32_t cycles, uint32_t mhz)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, ece391_itoa (cycles / mhz, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" us\n");
+}
+
+/* echolat [hogs] - time from pressing enter to a program waiting for the line
+   running again, with hogs processes spinning alongside it for HOG_SECONDS */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t hogs, mhz, deadline, i, took, best, worst, total;
+    int32_t pid;
+
+    mhz = ECE391_KERNEL_DATA->tsc_khz / 1000;
+    if (0 == mhz) {
+        ece391_fdputs (1, (uint8_t*)"time stamp counter speed unknown\n");
+        return 1;
+    }
+    hogs = 0;
+    if (0 == ece391_getargs (buf, BUFSIZE) && buf[0] >= '1' && buf[0] <= '9')
+        hogs = buf[0] - '0';
+
+    /* not pit_ticks, which stands still while a hog that makes no system calls
+       runs alone with the PIT stopped */
+    deadline = ece391_pit_ticks () + HOG_SECONDS * ECE391_KERNEL_DATA->pit_hz;
+    for (i = 0; i < hogs; i++) {
+        pid = ece391_fork ();
+        if (0 == pid) {
+            while ((int32_t)(deadline - ece391_pit_ticks ()) > 0);
+            ece391_halt (0);
+        }
+        if (-1 == pid) {
+            ece391_fdputs (1, (uint8_t*)"fork failed\n");
+            hogs = i;
+            break;
+        }
+    }
+
+    best = 0xFFFFFFFF;
+    worst = 0;
+    total = 0;
+    for (i = 0; i < PRESSES; i++) {
+        ece391_fdputs (1, (uint8_t*)"press enter: ");
+        if (-1 == ece391_read (0, buf, BUFSIZE))
+            break;
+        took = rdtsc () - ECE391_KERNEL_DATA->enter_tsc;
+        total += took;
+        if (took < best)
+            best = took;
+        if (took > worst)
+            worst = took;
+    }
+
+    if (i > 0) {
+        report ("best  ", best, mhz);
+        report ("mean  ", total / i, mhz);
+        report ("worst ", worst, mhz);
+    }
+    if (0 != hogs)
+        ece391_fdputs (1, (uint8_t*)"waiting for the hogs to finish\n");
+    for (i = 0; i < hogs; i++)
+        ece391_wait (-1, 0, 0);
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 20
+#define BUFSIZE 16
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+void
+report (const char* name, uint32_t total, uint32_t best)
+{
+    uint8_t buf[BUFSIZE];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, (uint8_t*)": ");
+    ece391_fdputs (1, ece391_itoa (total / ROUNDS, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles, best ");
+    ece391_fdputs (1, ece391_itoa (best, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+/* forkbench - fork of a child that halts at once, against execute and spawn of a
+   program that does.  Each round runs until the child is collected, so a child
+   that has to wait for a timer tick to be scheduled shows in the total */
+int main ()
+{
+    uint8_t args[BUFSIZE];
+    uint32_t i, start, took, best, total;
+    int32_t pid;
+
+    if (0 == ece391_getargs (args, BUFSIZE) && 0 == ece391_strcmp (args, (uint8_t*)"halt"))
+        return 0;
+
+    best = 0xFFFFFFFF;
+    total = 0;
+    for (i = 0; i < ROUNDS; i++) {
+        start = rdtsc ();
+        pid = ece391_fork ();
+        if (0 == pid)
+            ece391_halt (0);
+        if (-1 == pid || -1 == ece391_wait (pid, 0, 0)) {
+            ece391_fdputs (1, (uint8_t*)"fork failed\n");
+            return 1;
+        }
+        took = rdtsc () - start;
+        total += took;
+        if (took < best)
+            best = took;
+    }
+    report ("fork + wait   ", total, best);
+
+    best = 0xFFFFFFFF;
+    total = 0;
+    for (i = 0; i < ROUNDS; i++) {
+        start = rdtsc ();
+        ece391_execute ((uint8_t*)"forkbench halt");
+        took = rdtsc () - start;
+        total += took;
+        if (took < best)
+            best = took;
+    }
+    report ("execute + halt", total, best);
+
+    best = 0xFFFFFFFF;
+    total = 0;
+    for (i = 0; i < ROUNDS; i++) {
+        start = rdtsc ();
+        pid = ece391_spawn ((uint8_t*)"forkbench halt", -1, -1);
+        if (-1 == pid || -1 == ece391_wait (pid, 0, 0)) {
+            ece391_fdputs (1, (uint8_t*)"spawn failed\n");
+            return 1;
+        }
+        took = rdtsc () - start;
+        total += took;
+        if (took < best)
+            best = took;
+    }
+    report ("spawn + wait  ", total, best);
+    return 0;
+}
@@ -6,17 +6,60 @@
 #define BUFSIZE 1024
 #define SBUFSIZE 33
 
+void
+print_match (const char* fname, int32_t f_len, uint8_t* line, int32_t len)
+{
+    struct ece391_iovec iov[4];
+
+    /* "fname:line\n" in one write, just "line\n" for stdin */
+    iov[0].base = (void*)fname;
+    iov[0].len = f_len;
+    iov[1].base = ":";
+    iov[1].len = 1;
+    iov[2].base = line;
+    iov[2].len = len;
+    iov[3].base = "\n";
+    iov[3].len = 1;
+    if (0 == f_len)
+        ece391_writev (1, iov + 2, 2);
+    else
+        ece391_writev (1, iov, 4);
+}
+
 int32_t
-do_one_file (const char* s, const char* fname) 
+map_one_file (const char* s, int32_t fd, const char* fname)
 {
-    int32_t fd, cnt, last, line_start, line_end, check, s_len;
-    uint8_t data[BUFSIZE+1];
+    int32_t length, line_start, line_end, check, s_len, f_len;
+    uint8_t* data;
 
-    s_len = ece391_strlen ((uint8_t*)s);
-    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
-        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+    /* the file is scanned in place, nothing is copied out of it */
+    if (-1 == (length = ece391_mmap (fd, &data)))
         return -1;
+    s_len = ece391_strlen ((uint8_t*)s);
+    f_len = ece391_strlen ((uint8_t*)fname);
+    for (line_start = 0; line_start < length; line_start = line_end + 1) {
+        line_end = line_start;
+        while (line_end < length && '\n' != data[line_end])
+            line_end++;
+        for (check = line_start; check + s_len <= line_end; check++) {
+            if (s[0] == data[check] &&
+                0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
+                print_match (fname, f_len, data + line_start, line_end - line_start);
+                break;
+            }
+        }
     }
+    return 0;
+}
+
+int32_t
+read_one_file (const char* s, int32_t fd, const char* fname)
+{
+    int32_t cnt, last, line_start, line_end, check, s_len, f_len;
+    uint8_t data[BUFSIZE+1];
+
+    s_len = ece391_strlen ((uint8_t*)s);
+    f_len = ece391_strlen ((uint8_t*)fname);
     last = 0;
     while (1) {
         cnt = ece391_read (fd, data + last, BUFSIZE - last);
@@ -42,10 +85,7 @@ do_one_file (const char* s, const char* fname)
 	    for (check = line_start; check < line_end; check++) {
 		if (s[0] == data[check] && 
 		    0 == ece391_strncmp ((uint8_t*)(data + check), (uint8_t*)s, s_len)) {
-		    ece391_fdputs (1, (uint8_t*)fname);
-		    ece391_fdputs (1, (uint8_t*)":");
-		    ece391_fdputs (1, data + line_start);
-		    ece391_fdputs (1, (uint8_t*)"\n");
+		    print_match (fname, f_len, data + line_start, line_end - line_start);
 		    break;
 		}
 	    }
@@ -58,6 +98,22 @@ do_one_file (const char* s, const char* fname)
 	if (0 == cnt)
 	    break;
     }
+    return 0;
+}
+
+int32_t
+do_one_file (const char* s, const char* fname) 
+{
+    int32_t fd;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)fname))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return -1;
+    }
+    /* fall back to reading the file if it cannot be mapped */
+    if (0 != map_one_file (s, fd, fname) &&
+        0 != read_one_file (s, fd, fname))
+        return -1;
     if (-1 == ece391_close (fd)) {
         ece391_fdputs (1, (uint8_t*)"file close failed\n");
         return -1;
@@ -76,6 +132,10 @@ int main ()
         return 3;
     }
 
+    /* "grep - string" searches stdin, such as the output of a pipe */
+    if ('-' == search[0] && ' ' == search[1])
+        return (0 == read_one_file ((char*)search + 2, 0, "")) ? 0 : 3;
+
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
 	return 2;
@@ -0,0 +1,48 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define RTC_HZ 2		/* the rate opening the rtc sets */
+#define DEFAULT_SECONDS 2
+#define BUFSIZE 16
+
+/* load [seconds] - how busy the processor was over a few seconds, from the
+   time the kernel's idle task spent halted */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    uint32_t seconds, i, idle, elapsed;
+    int32_t fd;
+
+    if (0 == ECE391_KERNEL_DATA->tsc_khz) {
+        ece391_fdputs (1, (uint8_t*)"idle time is not counted on this machine\n");
+        return 1;
+    }
+
+    seconds = DEFAULT_SECONDS;
+    if (0 == ece391_getargs (buf, BUFSIZE) && buf[0] >= '1' && buf[0] <= '9')
+        seconds = buf[0] - '0';
+    if (-1 == (fd = ece391_open ((uint8_t*)"rtc"))) {
+        ece391_fdputs (1, (uint8_t*)"rtc is in use\n");
+        return 1;
+    }
+
+    idle = ECE391_KERNEL_DATA->idle_ms;
+    for (i = 0; i < seconds * RTC_HZ; i++)
+        ece391_read (fd, buf, 0);
+    idle = ECE391_KERNEL_DATA->idle_ms - idle;
+    elapsed = seconds * 1000;
+    ece391_close (fd);
+
+    if (idle > elapsed)
+        idle = elapsed;
+    ece391_fdputs (1, (uint8_t*)"busy ");
+    ece391_fdputs (1, ece391_itoa (100 - idle * 100 / elapsed, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"%, idle ");
+    ece391_fdputs (1, ece391_itoa (idle, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" of ");
+    ece391_fdputs (1, ece391_itoa (elapsed, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" ms\n");
+    return 0;
+}
@@ -3,25 +3,35 @@
 #include "ece391support.h"
 #include "ece391syscall.h"
 
-#define SBUFSIZE 33
+#define DBUFSIZE 1024
+#define OBUFSIZE 1024
 
 int main ()
 {
-    int32_t fd, cnt;
-    uint8_t buf[SBUFSIZE];
+    int32_t fd, cnt, pos, len;
+    uint8_t buf[DBUFSIZE];
+    uint8_t out[OBUFSIZE];
+    struct ece391_dirent* d;
 
     if (-1 == (fd = ece391_open ((uint8_t*)"."))) {
         ece391_fdputs (1, (uint8_t*)"directory open failed\n");
         return 2;
     }
 
-    while (0 != (cnt = ece391_read (fd, buf, SBUFSIZE-1))) {
+    /* one system call per batch of entries, and one write per batch */
+    while (0 != (cnt = ece391_getdents (fd, buf, DBUFSIZE))) {
         if (-1 == cnt) {
 	        ece391_fdputs (1, (uint8_t*)"directory entry read failed\n");
 	        return 3;
 	    }
-	    buf[cnt] = '\n';
-	    if (-1 == ece391_write (1, buf, cnt + 1))
+	    len = 0;
+	    for (pos = 0; pos < cnt; pos += d->rec_len) {
+	        d = (struct ece391_dirent*)(buf + pos);
+	        ece391_strcpy (out + len, d->name);
+	        len += d->name_len;
+	        out[len++] = '\n';
+	    }
+	    if (-1 == ece391_write (1, out, len))
 	        return 3;
     }
 
@@ -0,0 +1,87 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define TOTAL (1024 * 1024)
+#define MAXCHUNK 4096
+#define NUMSIZE 16
+
+static uint8_t data[MAXCHUNK];
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+/* the consumer: reads the pipe to its end, exits 0 if every byte arrived */
+void
+consume (int32_t fd)
+{
+    int32_t cnt;
+    uint32_t total;
+
+    total = 0;
+    while (0 < (cnt = ece391_read (fd, data, MAXCHUNK)))
+        total += cnt;
+    ece391_halt ((-1 == cnt || TOTAL != total) ? 1 : 0);
+}
+
+/* sends TOTAL bytes through a pipe to a forked consumer, chunk bytes per write */
+int32_t
+run (uint32_t chunk)
+{
+    int32_t fds[2], pid, status;
+    uint32_t sent, start, took, ms;
+    uint8_t num[NUMSIZE];
+
+    if (-1 == ece391_pipe (fds) || -1 == (pid = ece391_fork ())) {
+        ece391_fdputs (1, (uint8_t*)"pipe or fork failed\n");
+        return -1;
+    }
+    if (0 == pid) {
+        ece391_close (fds[1]);
+        consume (fds[0]);
+    }
+    ece391_close (fds[0]);
+
+    start = rdtsc ();
+    for (sent = 0; sent < TOTAL; sent += chunk) {
+        if ((int32_t)chunk != ece391_write (fds[1], data, chunk)) {
+            ece391_fdputs (1, (uint8_t*)"write failed\n");
+            break;
+        }
+    }
+    ece391_close (fds[1]);
+    if (-1 == ece391_wait (pid, &status, 0) || 0 != status) {
+        ece391_fdputs (1, (uint8_t*)"consumer lost data\n");
+        return -1;
+    }
+    took = rdtsc () - start;
+
+    ece391_fdputs (1, (uint8_t*)"chunk ");
+    ece391_fdputs (1, ece391_itoa (chunk, num, 10));
+    ece391_fdputs (1, (uint8_t*)": ");
+    ece391_fdputs (1, ece391_itoa (took / (TOTAL / 1024), num, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per KB");
+    if (0 != ECE391_KERNEL_DATA->tsc_khz) {
+        ms = took / ECE391_KERNEL_DATA->tsc_khz;
+        ece391_fdputs (1, (uint8_t*)", ");
+        ece391_fdputs (1, ece391_itoa (TOTAL / 1024 * 1000 / (0 == ms ? 1 : ms), num, 10));
+        ece391_fdputs (1, (uint8_t*)" KB/s");
+    }
+    ece391_fdputs (1, (uint8_t*)"\n");
+    return 0;
+}
+
+/* pipebench - producer/consumer throughput of a pipe for a few write sizes */
+int main ()
+{
+    if (-1 == run (64) || -1 == run (512) || -1 == run (MAXCHUNK))
+        return 1;
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define PAGE_SIZE 4096
+#define MAX_PAGES 256
+#define DEFAULT_PAGES 16
+#define BUFSIZE 64
+
+/* zero until touched, so every page written here costs a frame */
+static uint8_t hog[MAX_PAGES * PAGE_SIZE];
+
+uint32_t
+parse (const uint8_t* s, uint32_t* value)
+{
+    uint32_t i;
+
+    *value = 0;
+    for (i = 0; s[i] >= '0' && s[i] <= '9'; i++)
+        *value = *value * 10 + (s[i] - '0');
+    while (' ' == s[i])
+        i++;
+    return i;
+}
+
+void
+report (uint32_t depth, const char* what)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, (uint8_t*)"depth ");
+    ece391_fdputs (1, ece391_itoa (depth, buf, 10));
+    ece391_fdputs (1, (uint8_t*)what);
+}
+
+/* procstress [pages [depth]] - touches pages of memory and runs itself again,
+   until execute fails or a child is killed for want of memory */
+int main ()
+{
+    uint8_t args[BUFSIZE], cmd[BUFSIZE], num[16];
+    uint32_t pages, depth, i;
+    int32_t status;
+
+    pages = DEFAULT_PAGES;
+    depth = 0;
+    if (0 == ece391_getargs (args, BUFSIZE) && '\0' != args[0]) {
+        i = parse (args, &pages);
+        parse (args + i, &depth);
+    }
+    if (pages > MAX_PAGES)
+        pages = MAX_PAGES;
+
+    for (i = 0; i < pages; i++)
+        hog[i * PAGE_SIZE] = 1;
+
+    ece391_strcpy (cmd, (uint8_t*)"procstress ");
+    ece391_strcpy (cmd + ece391_strlen (cmd), ece391_itoa (pages, num, 10));
+    ece391_strcpy (cmd + ece391_strlen (cmd), (uint8_t*)" ");
+    ece391_strcpy (cmd + ece391_strlen (cmd), ece391_itoa (depth + 1, num, 10));
+
+    status = ece391_execute (cmd);
+    if (-1 == status) {
+        report (depth + 1, ": execute failed, out of processes or memory\n");
+        return 0;
+    }
+    if (256 == status) {
+        report (depth + 1, ": child killed, out of memory\n");
+        return 0;
+    }
+    if (0 == depth)
+        ece391_fdputs (1, (uint8_t*)"procstress done\n");
+    return status;
+}
@@ -0,0 +1,100 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 64
+#define CHUNK 64
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+static struct ece391_ring ring;
+static uint8_t bufs[RING_ENTRIES][CHUNK];
+
+void
+report (const char* name, uint32_t cycles)
+{
+    uint8_t buf[16];
+
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, (uint8_t*)": ");
+    ece391_fdputs (1, ece391_itoa (cycles / (ROUNDS * RING_ENTRIES), buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per operation\n");
+}
+
+/* RING_ENTRIES operations queued, then one ring_enter */
+uint32_t
+ring_batch (uint32_t opcode, int32_t fd, int32_t len)
+{
+    uint32_t i, start;
+
+    for (i = 0; i < RING_ENTRIES; i++) {
+        ring.sq[(ring.sq_tail + i) % RING_ENTRIES].opcode = opcode;
+        ring.sq[(ring.sq_tail + i) % RING_ENTRIES].fd = fd;
+        ring.sq[(ring.sq_tail + i) % RING_ENTRIES].addr = (uint32_t)bufs[i];
+        ring.sq[(ring.sq_tail + i) % RING_ENTRIES].len = len;
+        ring.sq[(ring.sq_tail + i) % RING_ENTRIES].user_data = i;
+    }
+    start = rdtsc ();
+    ring.sq_tail += RING_ENTRIES;
+    ece391_ring_enter ();
+    ring.cq_head = ring.cq_tail;
+    return rdtsc () - start;
+}
+
+int main ()
+{
+    int32_t fd;
+    uint32_t i, j, start, plain, batched;
+
+    if (-1 == (fd = ece391_open ((uint8_t*)"fish"))) {
+        ece391_fdputs (1, (uint8_t*)"file open failed\n");
+        return 2;
+    }
+    ring.sq_head = ring.sq_tail = 0;
+    ring.cq_head = ring.cq_tail = 0;
+    ring.flags = 0;
+    if (-1 == ece391_ring_setup (&ring)) {
+        ece391_fdputs (1, (uint8_t*)"ring setup failed\n");
+        return 3;
+    }
+
+    /* zero byte terminal writes: nothing but the kernel crossing */
+    plain = 0;
+    batched = 0;
+    for (i = 0; i < ROUNDS; i++) {
+        start = rdtsc ();
+        for (j = 0; j < RING_ENTRIES; j++)
+            ece391_int_write (1, bufs[j], 0);
+        plain += rdtsc () - start;
+        batched += ring_batch (RING_WRITE, 1, 0);
+    }
+    report ("write, one syscall each", plain);
+    report ("write, ring           ", batched);
+
+    /* CHUNK byte reads of a file, rewound before every batch */
+    plain = 0;
+    batched = 0;
+    for (i = 0; i < ROUNDS; i++) {
+        ece391_lseek (fd, 0, SEEK_SET);
+        start = rdtsc ();
+        for (j = 0; j < RING_ENTRIES; j++)
+            ece391_int_read (fd, bufs[j], CHUNK);
+        plain += rdtsc () - start;
+        ece391_lseek (fd, 0, SEEK_SET);
+        batched += ring_batch (RING_READ, fd, CHUNK);
+    }
+    report ("read, one syscall each ", plain);
+    report ("read, ring             ", batched);
+
+    ece391_ring_setup (0);
+    ece391_close (fd);
+    return 0;
+}
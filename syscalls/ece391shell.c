@@ -4,14 +4,106 @@
 #include "ece391syscall.h"
 
 #define BUFSIZE 1024
+#define NUMSIZE 16
+
+/* says which background jobs have finished since the last prompt */
+void
+report_jobs (void)
+{
+    int32_t pid, status;
+    uint8_t num[NUMSIZE];
+
+    while (0 < (pid = ece391_wait (-1, &status, WAIT_NOHANG))) {
+        ece391_fdputs (1, (uint8_t*)"[");
+        ece391_fdputs (1, ece391_itoa (pid, num, 10));
+        ece391_fdputs (1, (uint8_t*)"] done, returned ");
+        ece391_fdputs (1, ece391_itoa (status, num, 10));
+        ece391_fdputs (1, (uint8_t*)"\n");
+    }
+}
+
+/* prints the number of a job left running in the background */
+void
+print_job (int32_t pid)
+{
+    uint8_t num[NUMSIZE];
+
+    ece391_fdputs (1, (uint8_t*)"[");
+    ece391_fdputs (1, ece391_itoa (pid, num, 10));
+    ece391_fdputs (1, (uint8_t*)"]\n");
+}
+
+/* says how a command run in the foreground ended */
+void
+report_status (int32_t rval)
+{
+    if (-1 == rval)
+	ece391_fdputs (1, (uint8_t*)"no such command\n");
+    else if (256 == rval)
+	ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
+    else if (0 != rval)
+	ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+}
+
+/* drops the spaces around a word in place */
+uint8_t*
+trim (uint8_t* s)
+{
+    uint32_t len;
+
+    while (' ' == *s)
+        s++;
+    len = ece391_strlen (s);
+    while (len > 0 && ' ' == s[len - 1])
+        len--;
+    s[len] = '\0';
+    return s;
+}
+
+/* left | right: runs both at once, left's output feeding right's input */
+void
+run_pipeline (uint8_t* left, uint8_t* right, int32_t background)
+{
+    int32_t fds[2], writer, reader, rval;
+
+    if (-1 == ece391_pipe (fds)) {
+        ece391_fdputs (1, (uint8_t*)"pipe failed\n");
+	return;
+    }
+    writer = ece391_spawn (left, -1, fds[1]);
+    reader = ece391_spawn (right, fds[0], -1);
+    /* only the programs hold the pipe now, so right sees the end of left's output */
+    ece391_close (fds[0]);
+    ece391_close (fds[1]);
+
+    if (-1 == writer || -1 == reader) {
+	ece391_fdputs (1, (uint8_t*)"no such command\n");
+	/* the one that started finds nobody on the other end and finishes */
+	if (-1 != writer)
+	    ece391_wait (writer, 0, 0);
+	if (-1 != reader)
+	    ece391_wait (reader, 0, 0);
+	return;
+    }
+    if (background) {
+	print_job (writer);
+	print_job (reader);
+	return;
+    }
+    ece391_wait (writer, 0, 0);
+    ece391_wait (reader, &rval, 0);
+    report_status (rval);
+}
 
 int main ()
 {
-    int32_t cnt, rval;
+    int32_t cnt, rval, background;
     uint8_t buf[BUFSIZE];
+    uint8_t* bar;
     ece391_fdputs (1, (uint8_t*)"Starting 391 Shell\n");
 
     while (1) {
+        report_jobs ();
         ece391_fdputs (1, (uint8_t*)"391OS> ");
 	if (-1 == (cnt = ece391_read (0, buf, BUFSIZE-1))) {
 	    ece391_fdputs (1, (uint8_t*)"read from keyboard failed\n");
@@ -19,18 +111,35 @@ int main ()
 	}
 	if (cnt > 0 && '\n' == buf[cnt - 1])
 	    cnt--;
+	/* a command ending in & runs in the background */
+	background = 0;
+	while (cnt > 0 && ' ' == buf[cnt - 1])
+	    cnt--;
+	if (cnt > 0 && '&' == buf[cnt - 1]) {
+	    background = 1;
+	    cnt--;
+	    while (cnt > 0 && ' ' == buf[cnt - 1])
+		cnt--;
+	}
 	buf[cnt] = '\0';
 	if (0 == ece391_strcmp (buf, (uint8_t*)"exit"))
 	    return 0;
 	if ('\0' == buf[0])
 	    continue;
-	rval = ece391_execute (buf);
-	if (-1 == rval)
-	    ece391_fdputs (1, (uint8_t*)"no such command\n");
-	else if (256 == rval)
-	    ece391_fdputs (1, (uint8_t*)"program terminated by exception\n");
-	else if (0 != rval)
-	    ece391_fdputs (1, (uint8_t*)"program terminated abnormally\n");
+	for (bar = buf; '\0' != *bar && '|' != *bar; bar++);
+	if ('|' == *bar) {
+	    *bar = '\0';
+	    run_pipeline (trim (buf), trim (bar + 1), background);
+	    continue;
+	}
+	if (background) {
+	    if (-1 == (rval = ece391_spawn (buf, -1, -1)))
+		ece391_fdputs (1, (uint8_t*)"no such command\n");
+	    else
+		print_job (rval);
+	    continue;
+	}
+	report_status (ece391_execute (buf));
     }
 }
 
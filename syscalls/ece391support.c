@@ -102,3 +102,34 @@ uint8_t* ece391_strrev(uint8_t* s)
    return s;
 }
 
+
+/* PIT periods since boot, with the ones the kernel has not yet counted in
+   pit_ticks added from the time stamp counter when it is tickless */
+uint32_t ece391_pit_ticks(void)
+{
+    volatile struct ece391_kernel_data* data = ECE391_KERNEL_DATA;
+    uint32_t ticks, cycles, chunk;
+    uint64_t base, elapsed;
+
+    /* the kernel changes pit_ticks whenever it moves the base, so a
+       base read between two equal counts belongs to that count */
+    do {
+        ticks = data->pit_ticks;
+        base = ((uint64_t)data->clock_tsc_high << 32) | data->clock_tsc_low;
+    } while (ticks != data->pit_ticks);
+
+    cycles = data->clock_cycles;
+    if (0 == cycles)
+        return ticks;
+
+    asm volatile ("rdtsc" : "=A" (elapsed));
+    elapsed -= base;
+
+    /* no 64 bit division without a library, take it a low half at a time */
+    chunk = 0xFFFFFFFF / cycles;
+    while (0 != (elapsed >> 32)) {
+        ticks += chunk;
+        elapsed -= (uint64_t)chunk * cycles;
+    }
+    return ticks + (uint32_t)elapsed / cycles;
+}
@@ -0,0 +1,100 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 1000
+#define MAX_SLEEPERS 99
+#define BUFSIZE 16
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+uint32_t
+parse (const uint8_t* s)
+{
+    uint32_t value;
+
+    for (value = 0; *s >= '0' && *s <= '9'; s++)
+        value = value * 10 + (*s - '0');
+    return value;
+}
+
+/* switchbench [sleepers] - round trips of a byte between two processes over a
+   pair of pipes, each one two switches, with sleepers more processes blocked on
+   a pipe nobody writes.  The cost per round trip should not depend on how many
+   are asleep */
+int main ()
+{
+    uint8_t buf[BUFSIZE];
+    int32_t idle[2], ping[2], pong[2], pid;
+    uint32_t sleepers, i, start, took;
+
+    sleepers = 0;
+    if (0 == ece391_getargs (buf, BUFSIZE))
+        sleepers = parse (buf);
+    if (sleepers > MAX_SLEEPERS)
+        sleepers = MAX_SLEEPERS;
+
+    if (-1 == ece391_pipe (idle) || -1 == ece391_pipe (ping) || -1 == ece391_pipe (pong)) {
+        ece391_fdputs (1, (uint8_t*)"pipe failed\n");
+        return 1;
+    }
+
+    /* each sleeper reads until the last write end, the one kept here, is closed */
+    for (i = 0; i < sleepers; i++) {
+        pid = ece391_fork ();
+        if (0 == pid) {
+            ece391_close (idle[1]);
+            ece391_close (ping[0]);
+            ece391_close (ping[1]);
+            ece391_close (pong[0]);
+            ece391_close (pong[1]);
+            ece391_read (idle[0], buf, 1);
+            ece391_halt (0);
+        }
+        if (-1 == pid) {
+            ece391_fdputs (1, (uint8_t*)"fork failed\n");
+            sleepers = i;
+            break;
+        }
+    }
+
+    pid = ece391_fork ();
+    if (0 == pid) {
+        ece391_close (idle[1]);
+        ece391_close (ping[1]);
+        ece391_close (pong[0]);
+        while (1 == ece391_read (ping[0], buf, 1))
+            ece391_write (pong[1], buf, 1);
+        ece391_halt (0);
+    }
+    if (-1 == pid) {
+        ece391_fdputs (1, (uint8_t*)"fork failed\n");
+        return 1;
+    }
+
+    start = rdtsc ();
+    for (i = 0; i < ROUNDS; i++) {
+        ece391_write (ping[1], buf, 1);
+        ece391_read (pong[0], buf, 1);
+    }
+    took = rdtsc () - start;
+
+    ece391_fdputs (1, ece391_itoa (sleepers, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" asleep: ");
+    ece391_fdputs (1, ece391_itoa (took / ROUNDS, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per round trip\n");
+
+    ece391_close (ping[1]);
+    ece391_close (idle[1]);
+    for (i = 0; i < sleepers + 1; i++)
+        ece391_wait (-1, 0, 0);
+    return 0;
+}
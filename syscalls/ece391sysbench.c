@@ -0,0 +1,47 @@
+#include <stdint.h>
+
+#include "ece391support.h"
+#include "ece391syscall.h"
+
+#define ROUNDS 10000
+
+static inline uint32_t
+rdtsc (void)
+{
+    uint32_t low, high;
+
+    asm volatile ("rdtsc" : "=a" (low), "=d" (high));
+    return low;
+}
+
+/* zero byte writes to the terminal, so the time is the kernel round trip */
+void
+report (const char* name, int32_t (*call)(int32_t, const void*, int32_t))
+{
+    uint32_t i, start, took, best, total;
+    uint8_t buf[16];
+
+    best = 0xFFFFFFFF;
+    total = 0;
+    for (i = 0; i < ROUNDS; i++) {
+        start = rdtsc ();
+        call (1, buf, 0);
+        took = rdtsc () - start;
+        total += took;
+        if (took < best)
+            best = took;
+    }
+    ece391_fdputs (1, (uint8_t*)name);
+    ece391_fdputs (1, (uint8_t*)": ");
+    ece391_fdputs (1, ece391_itoa (total / ROUNDS, buf, 10));
+    ece391_fdputs (1, (uint8_t*)" cycles per call, best ");
+    ece391_fdputs (1, ece391_itoa (best, buf, 10));
+    ece391_fdputs (1, (uint8_t*)"\n");
+}
+
+int main ()
+{
+    report ("int $0x80", ece391_int_write);
+    report ("sysenter ", ece391_write);
+    return 0;
+}
@@ -22,6 +22,160 @@ extern int32_t ece391_vidmap (uint8_t** screen_start);
 extern int32_t ece391_set_handler (int32_t signum, void* handler);
 extern int32_t ece391_sigreturn (void);
 
+/*
+ * read and write above use SYSENTER when the processor supports it; these
+ * always use INT $0x80.
+ */
+extern int32_t ece391_int_read (int32_t fd, void* buf, int32_t nbytes);
+extern int32_t ece391_int_write (int32_t fd, const void* buf, int32_t nbytes);
+
+/*
+ * getdents fills buf with as many directory entries as fit, packed back to
+ * back rec_len bytes apart, and returns the number of bytes used (0 once the
+ * directory is exhausted).
+ */
+struct ece391_dirent {
+	uint32_t inode_num;
+	uint32_t size;
+	uint16_t rec_len;
+	uint8_t f_type;
+	uint8_t name_len;
+	uint8_t name[];
+};
+extern int32_t ece391_getdents (int32_t fd, void* buf, int32_t nbytes);
+
+/* 
+ * readv and writev move several buffers, in order, in one call; readv
+ * stops at the first buffer it cannot fill.
+ */
+struct ece391_iovec {
+	void* base;
+	int32_t len;
+};
+extern int32_t ece391_readv (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+extern int32_t ece391_writev (int32_t fd, const struct ece391_iovec* iov, int32_t iovcnt);
+
+/*
+ * mmap maps an open file read only into the program's address space; it
+ * returns the file's length and sets *start to its first byte.  Mappings
+ * last until the program halts.
+ */
+extern int32_t ece391_mmap (int32_t fd, uint8_t** start);
+
+/* 
+ * lseek moves a regular file's position and returns the new one; pread
+ * reads at an offset without touching the position.
+ */
+#define SEEK_SET 0
+#define SEEK_CUR 1
+#define SEEK_END 2
+extern int32_t ece391_lseek (int32_t fd, int32_t offset, int32_t whence);
+extern int32_t ece391_pread (int32_t fd, void* buf, int32_t nbytes, uint32_t offset);
+
+/* 
+ * sendfile writes up to count bytes of a regular file to the terminal
+ * without copying them through the caller, returning the number sent.
+ */
+extern int32_t ece391_sendfile (int32_t out_fd, int32_t in_fd, int32_t count);
+
+/*
+ * A submission ring batches read, write, open and close.  Fill sq, bump
+ * sq_tail, then ring_enter runs everything queued in one call and posts a
+ * completion per operation at cq_tail; consume them by bumping cq_head.
+ * With RING_POLL set the kernel also drains the ring on timer ticks.
+ */
+#define RING_ENTRIES 32
+#define RING_POLL 0x1
+#define RING_READ 1
+#define RING_WRITE 2
+#define RING_OPEN 3
+#define RING_CLOSE 4
+struct ece391_sqe {
+	uint32_t opcode;
+	int32_t fd;
+	uint32_t addr;
+	int32_t len;
+	uint32_t user_data;
+};
+struct ece391_cqe {
+	uint32_t user_data;
+	int32_t result;
+};
+struct ece391_ring {
+	volatile uint32_t sq_head;
+	volatile uint32_t sq_tail;
+	volatile uint32_t cq_head;
+	volatile uint32_t cq_tail;
+	uint32_t flags;
+	struct ece391_sqe sq[RING_ENTRIES];
+	struct ece391_cqe cq[RING_ENTRIES];
+};
+extern int32_t ece391_ring_setup (struct ece391_ring* ring);
+extern int32_t ece391_ring_enter (void);
+
+/*
+ * fork makes a copy of the calling program that runs alongside it, sharing
+ * its memory until either one writes.  It returns the child's process
+ * number in the parent and 0 in the child.
+ */
+extern int32_t ece391_fork (void);
+
+/*
+ * spawn starts a program like execute but returns its process number at
+ * once, leaving it to run alongside the caller.  The program's stdin and
+ * stdout are the caller's in_fd and out_fd, or the terminal for -1.
+ * wait collects a child
+ * made by fork or spawn once it halts, storing what it returned in status
+ * (which may be NULL).  pid -1 takes any child; with WAIT_NOHANG wait
+ * returns 0 instead of blocking if none has halted yet.  wait returns the
+ * child's process number, or -1 if there is no such child.
+ */
+#define WAIT_NOHANG 0x1
+extern int32_t ece391_spawn (const uint8_t* command, int32_t in_fd, int32_t out_fd);
+extern int32_t ece391_wait (int32_t pid, int32_t* status, int32_t flags);
+
+/*
+ * pipe opens a pipe, putting the fd of its read end in fds[0] and of its
+ * write end in fds[1].  A read waits for data and returns 0 once every
+ * write end is closed; a write waits for room and fails once every read
+ * end is closed.
+ */
+extern int32_t ece391_pipe (int32_t fds[2]);
+
+/*
+ * nice adds increment to the caller's nice value, kept from 0 to 3, and
+ * returns the new value.  The scheduler never ranks a program with nice n
+ * above the nth of its four levels, 0 being the first to run.  Programs
+ * started with execute, spawn or fork inherit the value.
+ */
+extern int32_t ece391_nice (int32_t increment);
+
+/*
+ * Every program can read this page; the kernel keeps it up to date from
+ * its interrupt handlers, so reading the time takes no system call.
+ */
+struct ece391_kernel_data {
+	uint32_t pit_ticks;	/* PIT periods since boot */
+	uint32_t rtc_ticks;	/* RTC interrupts since boot */
+	uint32_t pit_hz;	/* PIT interrupts per second */
+	uint32_t tsc_khz;	/* time stamp counter ticks per ms, 0 if unknown */
+	uint32_t pid;		/* process number of the running process */
+	uint32_t idle_ms;	/* time spent with nothing to run, 0 if tsc_khz is */
+	uint32_t timer_irqs;	/* PIT interrupts taken, fewer than pit_ticks when tickless */
+	uint32_t enter_tsc;	/* low half of the time stamp counter when enter was last pressed */
+	uint32_t clock_tsc_low;	/* time stamp counter pit_ticks was last brought */
+	uint32_t clock_tsc_high;	/* up to date at, when tickless */
+	uint32_t clock_cycles;	/* time stamp counter ticks per PIT period when tickless, else 0 */
+};
+#define ECE391_KERNEL_DATA ((volatile struct ece391_kernel_data*)0x09007000)
+
+/*
+ * When tickless the kernel only brings pit_ticks up to date on timer
+ * interrupts and system calls, so it stands still while a program runs
+ * alone without making any.  ece391_pit_ticks in ece391support.c adds the
+ * periods since then; time programs with it rather than pit_ticks.
+ */
+
 enum signums {
 	DIV_ZERO = 0,
 	SEGFAULT,
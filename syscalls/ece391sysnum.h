@@ -11,5 +11,19 @@
 #define SYS_VIDMAP  8
 #define SYS_SET_HANDLER  9
 #define SYS_SIGRETURN  10
+#define SYS_GETDENTS  11
+#define SYS_READV  12
+#define SYS_WRITEV  13
+#define SYS_MMAP  14
+#define SYS_LSEEK  15
+#define SYS_PREAD  16
+#define SYS_SENDFILE  17
+#define SYS_RING_SETUP  18
+#define SYS_RING_ENTER  19
+#define SYS_FORK  20
+#define SYS_SPAWN  21
+#define SYS_WAIT  22
+#define SYS_PIPE  23
+#define SYS_NICE  24
 
 #endif /* ECE391SYSNUM_H */